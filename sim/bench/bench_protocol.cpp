@@ -0,0 +1,338 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    bench_protocol.cpp
+/// @brief   Cost and size of sending a burn line with escaping and with COBS, and the cost of
+///          parsing commands. Lines go through protocol::send_response() into the UART's queue on
+///          the simulated analyser. Times are for the host's CPU, so compare them with each other
+///          rather than with the MicroBlaze.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <random>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "cpu.hpp"
+#include "host.hpp"
+#include "interrupt.hpp"
+#include "mech.hpp"
+#include "protocol.hpp"
+#include "timer.hpp"
+#include "uart.hpp"
+#include "uartlite.hpp"
+
+using namespace sim;
+using namespace std::chrono_literals;
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace {
+
+// Lines sent for each pattern. The queue is drained at the baud rate between batches, so this is
+// kept small enough not to take long.
+constexpr uint32_t LINES = 2'000;
+
+// Times round a buffer of commands, read in chunks the size the command task reads.
+constexpr uint32_t COMMAND_PASSES = 20'000;
+constexpr uint32_t CHUNK_SIZE = 64;
+
+// Wire bytes around the encoded line. Escaped is STX opcode ... ETX CR LF, COBS is a delimiter
+// either side with the opcode encoded along with the line.
+constexpr uint32_t ESCAPED_OVERHEAD = 5;
+constexpr uint32_t COBS_OVERHEAD = 2;
+
+constexpr double BYTES_PER_SECOND = static_cast<double>(uartlite::BAUD) / 10;
+
+using Line = std::array<uint8_t, mech::HEAD_BYTES>;
+
+// Enough random lines that their average cost and size is close to the expected.
+constexpr uint32_t RANDOM_LINES = 256;
+
+struct Pattern {
+    const char* name;
+    std::vector<Line> lines;
+};
+
+struct Result {
+    double ns_per_line;
+    double wire_bytes;
+};
+
+// Handed between the harness and the firmware's thread, which times the sends.
+std::vector<Pattern> patterns{};
+std::vector<Result> results{};
+constinit std::atomic<bool> sent{false};
+
+auto filled(const uint8_t byte) -> std::vector<Line> {
+    Line line{};
+    line.fill(byte);
+    return {line};
+}
+
+auto random_lines() -> std::vector<Line> {
+    std::mt19937 random{1};
+    std::uniform_int_distribution<uint32_t> byte{0, 0xFF};
+
+    std::vector<Line> lines(RANDOM_LINES);
+    for(auto& line : lines) {
+        std::generate(line.begin(), line.end(), [&] { return static_cast<uint8_t>(byte(random)); });
+    }
+    return lines;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Send the lines as the stream task does, as many as the queue has room for, then wait for
+///        the link to drain before the next batch. Only the sends are timed.
+auto run(const std::vector<Line>& lines, const bool cobs) -> Result {
+    protocol::set_framing(cobs ? protocol::Framing::Cobs : protocol::Framing::Escaped);
+
+    std::vector<double> batches{};
+    uint32_t count = 0;
+    while(count < LINES) {
+        while(!uart::idle()) {}
+
+        const auto first = count;
+        const auto start = std::chrono::steady_clock::now();
+        for(; count < LINES && protocol::frame_room(); count++) {
+            protocol::send_response(protocol::Response::BurnLine, lines[count % lines.size()]);
+        }
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        batches.push_back(std::chrono::duration<double, std::nano>(elapsed).count() /
+                          (count - first));
+    }
+    while(!uart::idle()) {}
+
+    // The median batch, as a tick landing in one makes it far slower than the rest.
+    const auto median = batches.begin() + static_cast<std::ptrdiff_t>(batches.size() / 2);
+    std::nth_element(batches.begin(), median, batches.end());
+
+    // What write_frame() puts on the wire for each line.
+    std::array<uint8_t, 1 + mech::HEAD_BYTES> block{'U'};
+    std::array<uint8_t, protocol::FRAME_MAX> output{};
+    uint64_t wire_bytes = 0;
+    for(const auto& line : lines) {
+        std::copy(line.begin(), line.end(), block.begin() + 1);
+        wire_bytes += cobs ? protocol::cobs_encode(block, output) + COBS_OVERHEAD
+                           : protocol::escape(line, output) + ESCAPED_OVERHEAD;
+    }
+
+    return Result{.ns_per_line = *median,
+                  .wire_bytes = static_cast<double>(wire_bytes) /
+                                static_cast<double>(lines.size())};
+}
+
+/// @brief Runs on the firmware's thread in place of main(), with just the UART brought up.
+auto sender() -> int {
+    timer::init();
+    interrupt::init();
+    uart::init();
+
+    for(const auto cobs : {false, true}) {
+        for(const auto& pattern : patterns) {
+            results.push_back(run(pattern.lines, cobs));
+        }
+    }
+
+    sent.store(true, std::memory_order_release);
+    while(true) {}
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief The parser as of ba0f609, a byte at a time with the escape state kept as a flag, for a
+///        baseline. Its commands are mapped onto today's.
+namespace baseline {
+
+enum class State {
+    Idle,
+    Processing,
+};
+
+constexpr uint8_t FRAME_START = 0x02;
+constexpr uint8_t FRAME_END = 0x03;
+constexpr uint8_t ESCAPE = 0x1B;
+
+constinit State state = State::Idle;
+constinit bool escape_next = false;
+constinit std::array<uint8_t, 64> cmd_buffer{};
+constinit uint32_t cmd_buffer_in_ptr{};
+
+auto process_command() -> std::optional<protocol::Command> {
+    switch(cmd_buffer.front()) {
+        case 'P': return protocol::Command::Poll;
+
+        case 'A': return protocol::Command::SetPaperIn;
+        case 'a': return protocol::Command::SetPaperOut;
+
+        case 'L': return protocol::Command::SetPlatenIn;
+        case 'l': return protocol::Command::SetPlatenOut;
+
+        case 'R': return protocol::Command::RecordingStart;
+        case 'r': return protocol::Command::RecordingStop;
+
+        default: return protocol::Command::Unrecognised;
+    }
+}
+
+// Called a byte at a time from another translation unit, as main() did.
+[[gnu::noinline]] auto process_byte(uint8_t byte) -> std::optional<protocol::Command> {
+    if(state == State::Idle) {
+        if(byte == FRAME_START) {
+            cmd_buffer_in_ptr = 0;
+            state = State::Processing;
+        }
+        return std::nullopt;
+    }
+
+    if(byte == FRAME_START && !escape_next) {
+        state = State::Idle;
+        return protocol::Command::FrameError;
+    }
+
+    if(byte == FRAME_END && !escape_next) {
+        state = State::Idle;
+        return process_command();
+    }
+
+    if(byte == ESCAPE && !escape_next) {
+        escape_next = true;
+        return std::nullopt;
+    }
+
+    cmd_buffer[cmd_buffer_in_ptr++] = byte;
+    escape_next = false;
+
+    return std::nullopt;
+}
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief What the host sends while streaming: polls, credit grants and sensor changes, and
+///        retransmit requests whose sequence numbers need escaping now and then.
+auto command_stream() -> std::vector<uint8_t> {
+    std::vector<uint8_t> stream{};
+    const auto frame = [&stream](const uint8_t opcode, std::span<const uint8_t> argument) {
+        stream.push_back(baseline::FRAME_START);
+        stream.push_back(opcode);
+        for(const auto byte : argument) {
+            if(byte == baseline::FRAME_START || byte == baseline::FRAME_END ||
+               byte == baseline::ESCAPE) {
+                stream.push_back(baseline::ESCAPE);
+            }
+            stream.push_back(byte);
+        }
+        stream.push_back(baseline::FRAME_END);
+    };
+
+    for(uint32_t i = 0; i < 256; i++) {
+        const auto sequence = static_cast<uint8_t>(i);
+        frame('P', {});
+        frame('G', std::array<uint8_t, 1>{8});
+        frame((i % 2 == 0) ? 'A' : 'a', {});
+        frame('N', std::array<uint8_t, 3>{sequence, 0, 4});
+    }
+    return stream;
+}
+
+/// @brief Parse the stream over and over, handing each chunk to parse.
+/// @return ns per byte and the number of commands found in one pass.
+template<typename Parse>
+auto time_parser(std::span<const uint8_t> stream, Parse parse) -> std::pair<double, uint64_t> {
+    uint64_t found = 0;
+
+    const auto start = std::chrono::steady_clock::now();
+    for(uint32_t pass = 0; pass < COMMAND_PASSES; pass++) {
+        for(size_t offset = 0; offset < stream.size(); offset += CHUNK_SIZE) {
+            found += parse(stream.subspan(offset, std::min<size_t>(CHUNK_SIZE,
+                                                                   stream.size() - offset)));
+        }
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    const auto ns = std::chrono::duration<double, std::nano>(elapsed).count();
+    const auto bytes = static_cast<double>(stream.size()) * COMMAND_PASSES;
+    return {ns / bytes, found / COMMAND_PASSES};
+}
+
+auto parsing() -> void {
+    const auto stream = command_stream();
+
+    const auto [per_byte_ns, per_byte_found] = time_parser(stream, [](const auto chunk) {
+        uint64_t found = 0;
+        for(const auto byte : chunk) {
+            found += baseline::process_byte(byte) ? 1U : 0U;
+        }
+        return found;
+    });
+
+    const auto [table_ns, table_found] = time_parser(stream, [](const auto chunk) {
+        std::array<protocol::Message, CHUNK_SIZE / 2> messages{};
+        return protocol::process(chunk, messages);
+    });
+
+    std::printf("parsing %zu bytes of commands in %u byte chunks\n", stream.size(), CHUNK_SIZE);
+    std::puts("  parser        ns/byte  commands");
+    std::printf("  per byte     %8.2f  %8llu\n",
+                per_byte_ns,
+                static_cast<unsigned long long>(per_byte_found));
+    std::printf("  table driven %8.2f  %8llu\n",
+                table_ns,
+                static_cast<unsigned long long>(table_found));
+}
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto main() -> int {
+    // Parsed before the firmware's thread starts, so the two don't share the CPU.
+    parsing();
+
+    patterns = {
+        Pattern{.name = "zero", .lines = filled(0x00)},
+        Pattern{.name = "0x02", .lines = filled(0x02)},
+        Pattern{.name = "0x03", .lines = filled(0x03)},
+        Pattern{.name = "0x1B", .lines = filled(0x1B)},
+        Pattern{.name = "random", .lines = random_lines()},
+    };
+
+    // The host end of the wire only has to keep up, what's sent is sized from the encoders.
+    cpu::boot(sender);
+    while(!sent.load(std::memory_order_acquire)) {
+        while(uartlite::receive()) {}
+        std::this_thread::sleep_for(1ms);
+    }
+
+    std::printf("\nsending a %u byte line, 230400 baud\n", mech::HEAD_BYTES);
+    std::puts("  framing  pattern  ns/line  ns/byte  wire bytes  expansion  lines/s");
+    auto result = results.begin();
+    for(const auto cobs : {false, true}) {
+        for(const auto& pattern : patterns) {
+            std::printf("  %-7s  %-7s  %7.1f  %7.2f  %10.1f  %9.2f  %7.0f\n",
+                        cobs ? "cobs" : "escaped",
+                        pattern.name,
+                        result->ns_per_line,
+                        result->ns_per_line / mech::HEAD_BYTES,
+                        result->wire_bytes,
+                        result->wire_bytes / mech::HEAD_BYTES,
+                        BYTES_PER_SECOND / result->wire_bytes);
+            result++;
+        }
+    }
+
+    host::exit(0);
+}
+
+/*------------------------------------------------------------------------------------------------*/
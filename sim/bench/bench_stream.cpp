@@ -0,0 +1,254 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    bench_stream.cpp
+/// @brief   Line throughput, latency and overflow on the simulated analyser. Times are simulated,
+///          so they're what the real board would see if the firmware ran as fast on it as here.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string_view>
+#include <thread>
+#include <variant>
+#include <vector>
+
+#include "cpu.hpp"
+#include "host.hpp"
+#include "llfifo.hpp"
+#include "print_mech.hpp"
+#include "uartlite.hpp"
+
+using namespace sim;
+using namespace std::chrono_literals;
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace {
+
+constexpr uint8_t ACK = 0x06;
+
+// Short enough that the mech is never what holds the lines back.
+constexpr uint32_t BURN = 1'000;
+
+constexpr double CYCLES_PER_US = static_cast<double>(cpu::FREQUENCY) / 1e6;
+
+enum class Data {
+    Blank,
+    Sparse,
+    Random,
+};
+
+struct Mode {
+    const char* name;
+    uint8_t enable;
+    uint8_t disable;
+};
+
+constexpr std::array MODES{
+    Mode{.name = "raw", .enable = 0, .disable = 0},
+    Mode{.name = "compressed", .enable = 'C', .disable = 'c'},
+    Mode{.name = "cobs", .enable = 'O', .disable = 'o'},
+};
+
+/// @brief What came back from running a script.
+struct Result {
+    std::vector<uint64_t> line_times;
+    std::vector<uint64_t> end_times;
+    uint64_t bytes;
+    uint32_t drop_errors;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto name(const Data data) -> const char* {
+    switch(data) {
+        case Data::Blank: return "blank";
+        case Data::Sparse: return "sparse";
+        case Data::Random: return "random";
+    }
+    return "";
+}
+
+auto make_lines(const Data data, const uint32_t count) -> std::vector<host::Line> {
+    std::mt19937 random{1};
+    std::uniform_int_distribution<uint32_t> byte{0, 0xFF};
+
+    std::vector<host::Line> lines(count);
+    for(uint32_t i = 0; i < count; i++) {
+        auto& line = lines[i];
+        switch(data) {
+            case Data::Blank: break;
+            case Data::Sparse: line[(i * 5) % line.size()] = 0x18; break;
+            case Data::Random:
+                std::generate(line.begin(), line.end(), [&] {
+                    return static_cast<uint8_t>(byte(random));
+                });
+                break;
+        }
+    }
+    return lines;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto set_mode(const Mode& mode) -> void {
+    if(mode.enable != 0) {
+        host::send(mode.enable);
+    }
+    host::set_cobs(mode.enable == 'O');
+    host::send('R');
+    host::send('P');
+    host::expect_frame(ACK);
+}
+
+auto clear_mode(const Mode& mode) -> void {
+    if(mode.disable != 0) {
+        host::send(mode.disable);
+    }
+    host::set_cobs(false);
+    host::send('P');
+    host::expect_frame(ACK);
+}
+
+/// @brief Print lines period cycles apart and collect everything sent until the link goes quiet.
+auto play(const std::vector<host::Line>& lines, const uint32_t period) -> Result {
+    print_mech::Script script{};
+    for(const auto& line : lines) {
+        script.push_back(print_mech::line(line, period - BURN, BURN));
+    }
+
+    const auto bytes = host::received();
+    print_mech::run(script);
+
+    Result result{};
+    while(true) {
+        const auto output = host::next(print_mech::done() ? 200ms : host::TIMEOUT);
+        if(!output) {
+            break;
+        }
+
+        if(const auto* const frame = std::get_if<host::Frame>(&output.value()); frame != nullptr) {
+            const auto code = frame->opcode;
+            if(code == 'U' || code == 'Z' || code == 'V') {
+                result.line_times.push_back(frame->time);
+            }
+        } else if(std::get<host::Text>(output.value()).text.starts_with("Error: burn lines")) {
+            result.drop_errors++;
+        }
+    }
+
+    while(const auto raised = print_mech::raised()) {
+        if(raised->signal == print_mech::Signal::HeadOff) {
+            result.end_times.push_back(raised->time);
+        }
+    }
+    result.bytes = host::received() - bytes;
+    return result;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Lines back to back, as many as the burn buffer holds, so the link is the limit.
+auto throughput() -> void {
+    constexpr uint32_t LINES = 40;
+
+    std::puts("throughput, 40 lines back to back");
+    std::puts("  mode        data      bytes/line  lines/s");
+    for(const auto& mode : MODES) {
+        for(const auto data : {Data::Blank, Data::Sparse, Data::Random}) {
+            set_mode(mode);
+            const auto result = play(make_lines(data, LINES), 2 * BURN);
+            clear_mode(mode);
+
+            const auto& times = result.line_times;
+            const auto span = static_cast<double>(times.back() - times.front());
+            std::printf("  %-10s  %-8s  %10.1f  %7.0f\n",
+                        mode.name,
+                        name(data),
+                        static_cast<double>(result.bytes) / static_cast<double>(times.size()),
+                        static_cast<double>(times.size() - 1) * cpu::FREQUENCY / span);
+        }
+    }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief From a line's head turning off to the last byte of its frame arriving, with the link
+///        otherwise idle.
+auto latency() -> void {
+    constexpr uint32_t LINES = 200;
+    constexpr uint32_t PERIOD = 1'000'000;
+
+    std::puts("latency, head off to frame received, 100 lines/s");
+    std::puts("  mode        data      min us  median us  p99 us  max us");
+    for(const auto& mode : MODES) {
+        for(const auto data : {Data::Blank, Data::Random}) {
+            set_mode(mode);
+            const auto result = play(make_lines(data, LINES), PERIOD);
+            clear_mode(mode);
+
+            host::check(result.line_times.size() == result.end_times.size(), "every line sent");
+            std::vector<double> latencies{};
+            for(size_t i = 0; i < result.line_times.size(); i++) {
+                const auto cycles = result.line_times[i] - result.end_times[i];
+                latencies.push_back(static_cast<double>(cycles) / CYCLES_PER_US);
+            }
+            std::sort(latencies.begin(), latencies.end());
+
+            std::printf("  %-10s  %-8s  %6.0f  %9.0f  %6.0f  %6.0f\n",
+                        mode.name,
+                        name(data),
+                        latencies.front(),
+                        latencies[latencies.size() / 2],
+                        latencies[(latencies.size() * 99) / 100],
+                        latencies.back());
+        }
+    }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Random raw lines at rates around what the link can carry, counting what's lost.
+auto overflow() -> void {
+    constexpr uint32_t LINES = 300;
+
+    // A random line escapes to about 55 bytes on the wire.
+    constexpr uint32_t LINE_CYCLES = 55 * uartlite::BYTE_CYCLES;
+
+    std::puts("overflow, 300 random raw lines");
+    std::puts("  lines/s  link load  received  burn fifo drops  drop errors");
+    for(const auto load : {0.5, 0.8, 0.95, 1.1, 1.5, 2.0}) {
+        const auto period = static_cast<uint32_t>(LINE_CYCLES / load);
+        const auto overflows = llfifo::overflows();
+
+        set_mode(MODES[0]);
+        const auto result = play(make_lines(Data::Random, LINES), period);
+
+        std::printf("  %7.0f  %8.0f%%  %8zu  %15llu  %11u\n",
+                    static_cast<double>(cpu::FREQUENCY) / period,
+                    load * 100,
+                    result.line_times.size(),
+                    static_cast<unsigned long long>(llfifo::overflows() - overflows),
+                    result.drop_errors);
+    }
+}
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto main() -> int {
+    host::boot();
+
+    throughput();
+    latency();
+    overflow();
+
+    host::exit(0);
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,101 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    bus.cpp
+/// @brief   Routes the firmware's register accesses to the simulated peripherals.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+#include "xil_io.h"
+#include "xparameters.h"
+
+#include "cpu.hpp"
+#include "gpio.hpp"
+#include "llfifo.hpp"
+#include "tmrctr.hpp"
+#include "uartlite.hpp"
+
+/*------------------------------------------------------------------------------------------------*/
+// private functions
+/*------------------------------------------------------------------------------------------------*/
+
+namespace {
+
+// Every peripheral's registers sit in the first 64K of its address range.
+constexpr UINTPTR SPAN = 0x10000;
+
+auto in_range(const UINTPTR address, const UINTPTR base) -> bool {
+    return address >= base && address < base + SPAN;
+}
+
+[[noreturn]] auto unmapped(const char* access, const UINTPTR address) -> void {
+    std::fprintf(stderr, "sim: %s of unmapped address 0x%08lx\n", access, address);
+    std::abort();
+}
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// BSP functions
+/*------------------------------------------------------------------------------------------------*/
+
+u32 Xil_In32(const UINTPTR Addr) {
+    const sim::cpu::Critical critical{};
+
+    if(in_range(Addr, XPAR_AXI_UARTLITE_0_BASEADDR)) {
+        return sim::uartlite::read(static_cast<uint32_t>(Addr - XPAR_AXI_UARTLITE_0_BASEADDR));
+    }
+
+    if(in_range(Addr, XPAR_BURN_BUFFER_BASEADDR)) {
+        return sim::llfifo::read(static_cast<uint32_t>(Addr - XPAR_BURN_BUFFER_BASEADDR));
+    }
+
+    if(in_range(Addr, XPAR_TMRCTR_0_BASEADDR)) {
+        return sim::tmrctr::read(static_cast<uint32_t>(Addr - XPAR_TMRCTR_0_BASEADDR));
+    }
+
+    for(uint16_t device = 0; device < sim::gpio::COUNT; device++) {
+        const auto base = sim::gpio::BASE_ADDRESSES[device];
+        if(in_range(Addr, base)) {
+            return sim::gpio::read(device, static_cast<uint32_t>(Addr - base));
+        }
+    }
+
+    unmapped("read", Addr);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void Xil_Out32(const UINTPTR Addr, const u32 Value) {
+    const sim::cpu::Critical critical{};
+
+    if(in_range(Addr, XPAR_AXI_UARTLITE_0_BASEADDR)) {
+        sim::uartlite::write(static_cast<uint32_t>(Addr - XPAR_AXI_UARTLITE_0_BASEADDR), Value);
+        return;
+    }
+
+    if(in_range(Addr, XPAR_BURN_BUFFER_BASEADDR)) {
+        sim::llfifo::write(static_cast<uint32_t>(Addr - XPAR_BURN_BUFFER_BASEADDR), Value);
+        return;
+    }
+
+    if(in_range(Addr, XPAR_TMRCTR_0_BASEADDR)) {
+        sim::tmrctr::write(static_cast<uint32_t>(Addr - XPAR_TMRCTR_0_BASEADDR), Value);
+        return;
+    }
+
+    for(uint16_t device = 0; device < sim::gpio::COUNT; device++) {
+        const auto base = sim::gpio::BASE_ADDRESSES[device];
+        if(in_range(Addr, base)) {
+            sim::gpio::write(device, static_cast<uint32_t>(Addr - base), Value);
+            return;
+        }
+    }
+
+    unmapped("write", Addr);
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,62 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    channel.hpp
+/// @brief   Lock free queue between the test harness and the simulated hardware's thread.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <optional>
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace sim {
+
+/// @brief Single producer, single consumer queue. Unlike the firmware's RingBuffer it's made for
+///        two real threads, so the indexes are atomics. Safe to use from a signal handler.
+/// @tparam T Element type.
+/// @tparam N Capacity. Must be a power of two.
+template<typename T, uint32_t N>
+class Channel {
+    static_assert(N != 0 && (N & (N - 1)) == 0, "Channel capacity must be a power of two");
+
+public:
+    /// @return false if the channel was full and item was dropped.
+    auto push(const T& item) -> bool {
+        const auto head = _head.load(std::memory_order_relaxed);
+        if(head - _tail.load(std::memory_order_acquire) == N) {
+            return false;
+        }
+
+        _buffer[head & (N - 1)] = item;
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    auto pop() -> std::optional<T> {
+        const auto tail = _tail.load(std::memory_order_relaxed);
+        if(tail == _head.load(std::memory_order_acquire)) {
+            return std::nullopt;
+        }
+
+        const auto item = _buffer[tail & (N - 1)];
+        _tail.store(tail + 1, std::memory_order_release);
+        return item;
+    }
+
+    auto empty() const -> bool {
+        return _tail.load(std::memory_order_acquire) == _head.load(std::memory_order_acquire);
+    }
+
+private:
+    std::array<T, N> _buffer{};
+    std::atomic<uint32_t> _head{0};
+    std::atomic<uint32_t> _tail{0};
+};
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
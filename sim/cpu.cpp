@@ -0,0 +1,283 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    cpu.cpp
+/// @brief   Runs the firmware on a host thread, with a signal handler standing in for the
+///          MicroBlaze's interrupt.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <ctime>
+#include <thread>
+
+#include <pthread.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include "mb_interface.h"
+#include "xil_exception.h"
+
+#include "cpu.hpp"
+#include "intc.hpp"
+#include "print_mech.hpp"
+#include "tmrctr.hpp"
+#include "uartlite.hpp"
+
+/*------------------------------------------------------------------------------------------------*/
+// private variables
+/*------------------------------------------------------------------------------------------------*/
+
+namespace {
+
+// The hardware is stepped from a periodic signal delivered to the firmware's thread, so, as on
+// the MicroBlaze, an ISR only ever runs between two instructions of the code it interrupts.
+constexpr int TICK_SIGNAL = SIGUSR1;
+constexpr long TICK_NANOSECONDS = 20'000;
+
+// Time is the firmware thread's CPU time, so it only passes while the firmware runs and the
+// harness or the host scheduler taking the core away can't make the link look slow.
+constinit clockid_t clock_id{};
+constinit std::atomic<bool> booted{false};
+
+// Only touched by the firmware's thread, in and out of the signal handler.
+constinit volatile sig_atomic_t interrupts_on{0};
+constinit volatile sig_atomic_t servicing{0};
+constinit volatile sig_atomic_t critical_depth{0};
+constinit volatile sig_atomic_t deferred{0};
+constinit volatile UINTPTR interrupted_pc{0};
+
+constinit Xil_ExceptionHandler exception_handler{nullptr};
+constinit void* exception_data{nullptr};
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// private functions
+/*------------------------------------------------------------------------------------------------*/
+
+namespace {
+
+auto start_ticks() -> void;
+
+void on_tick(int signal, siginfo_t* info, void* context);
+auto program_counter(const void* context) -> UINTPTR;
+
+auto service() -> void;
+auto take_interrupts() -> void;
+auto kick() -> void;
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// public functions
+/*------------------------------------------------------------------------------------------------*/
+
+sim::cpu::Critical::Critical() {
+    critical_depth = critical_depth + 1;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+}
+
+sim::cpu::Critical::~Critical() {
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    const bool outermost = (critical_depth == 1) && (servicing == 0);
+    const bool due = (deferred != 0) || ((interrupts_on != 0) && intc::pending());
+    critical_depth = critical_depth - 1;
+
+    if(outermost && due) {
+        kick();
+    }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Start entry on its own thread. Returns once the clock is running.
+auto sim::cpu::boot(const Entry entry) -> void {
+    std::thread([entry] {
+        pthread_getcpuclockid(pthread_self(), &clock_id);
+        start_ticks();
+        booted.store(true, std::memory_order_release);
+        entry();
+    }).detach();
+
+    while(!booted.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Simulated cycles since the firmware started. Safe to call from any thread.
+auto sim::cpu::now() -> uint64_t {
+    if(!booted.load(std::memory_order_acquire)) {
+        return 0;
+    }
+
+    timespec time{};
+    clock_gettime(clock_id, &time);
+    const auto nanoseconds = (static_cast<uint64_t>(time.tv_sec) * 1'000'000'000U)
+                           + static_cast<uint64_t>(time.tv_nsec);
+    return nanoseconds / (1'000'000'000U / FREQUENCY);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto sim::cpu::interrupts_enabled() -> bool {
+    return interrupts_on != 0;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// BSP functions
+/*------------------------------------------------------------------------------------------------*/
+
+void microblaze_enable_interrupts() {
+    const sim::cpu::Critical critical{};
+    interrupts_on = 1;
+}
+
+void microblaze_disable_interrupts() {
+    interrupts_on = 0;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+}
+
+UINTPTR sim_mfgpr_r14() {
+    return interrupted_pc;
+}
+
+u32 sim_mfmsr() {
+    constexpr u32 MSR_IE = 0x2;
+    return (interrupts_on != 0) ? MSR_IE : 0;
+}
+
+void Xil_ExceptionInit() {}
+
+void Xil_ExceptionRegisterHandler(const u32 Id, const Xil_ExceptionHandler Handler, void* Data) {
+    if(Id == XIL_EXCEPTION_ID_INT) {
+        exception_handler = Handler;
+        exception_data = Data;
+    }
+}
+
+void Xil_ExceptionEnable() {
+    microblaze_enable_interrupts();
+}
+
+void Xil_ExceptionDisable() {
+    microblaze_disable_interrupts();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// private functions
+/*------------------------------------------------------------------------------------------------*/
+
+namespace {
+
+auto start_ticks() -> void {
+    struct sigaction action{};
+    action.sa_sigaction = on_tick;
+    action.sa_flags = SA_RESTART | SA_SIGINFO;
+    sigemptyset(&action.sa_mask);
+    sigaction(TICK_SIGNAL, &action, nullptr);
+
+    sigevent event{};
+    event.sigev_notify = SIGEV_THREAD_ID;
+    event.sigev_signo = TICK_SIGNAL;
+    // glibc only names this sigev_notify_thread_id from 2.41.
+    event._sigev_un._tid = gettid();
+
+    timer_t timer{};
+    timer_create(CLOCK_MONOTONIC, &event, &timer);
+
+    const itimerspec period{.it_interval = {.tv_sec = 0, .tv_nsec = TICK_NANOSECONDS},
+                            .it_value = {.tv_sec = 0, .tv_nsec = TICK_NANOSECONDS}};
+    timer_settime(timer, 0, &period, nullptr);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A tick landing in a register access is put off until the access is over. Where it
+///        landed is kept for ISRs that sample the program counter.
+void on_tick([[maybe_unused]] int signal, [[maybe_unused]] siginfo_t* info, void* context) {
+    const auto saved_errno = errno;
+
+    if(critical_depth != 0) {
+        deferred = 1;
+    } else {
+        deferred = 0;
+        interrupted_pc = program_counter(context);
+        service();
+    }
+
+    errno = saved_errno;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto program_counter(const void* const context) -> UINTPTR {
+    const auto& machine = static_cast<const ucontext_t*>(context)->uc_mcontext;
+#if defined(__x86_64__)
+    return static_cast<UINTPTR>(machine.gregs[REG_RIP]);
+#elif defined(__aarch64__)
+    return static_cast<UINTPTR>(machine.pc);
+#else
+    static_cast<void>(machine);
+    return 0;
+#endif
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Bring the peripherals up to date and take whatever interrupts they raised. The print
+///        mech is stepped an event at a time so each one's ISR runs before the next, as it would
+///        on hardware that's keeping up. While interrupts are off it waits rather than raising an
+///        edge that's already latched, which would lose an event.
+auto service() -> void {
+    servicing = 1;
+
+    sim::uartlite::step(sim::cpu::now());
+    sim::tmrctr::step(sim::cpu::now());
+    do {
+        take_interrupts();
+    } while(!sim::intc::pending() && sim::print_mech::step(sim::cpu::now()));
+
+    servicing = 0;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Take pending interrupts, lowest input first, while the firmware has them enabled. Fast
+///        interrupts go straight to their handler, acknowledged on the way, the rest through the
+///        registered exception handler.
+auto take_interrupts() -> void {
+    while(interrupts_on != 0) {
+        const auto input = sim::intc::next();
+        if(!input) {
+            return;
+        }
+
+        interrupts_on = 0;
+        if(const auto fast = sim::intc::fast_handler(input.value()); fast != nullptr) {
+            sim::intc::acknowledge(input.value());
+            fast();
+        } else if(exception_handler != nullptr) {
+            exception_handler(exception_data);
+        } else {
+            sim::intc::acknowledge(input.value());
+        }
+        interrupts_on = 1;
+    }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Service the hardware now rather than at the next tick.
+auto kick() -> void {
+    deferred = 0;
+    pthread_kill(pthread_self(), TICK_SIGNAL);
+}
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
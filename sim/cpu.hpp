@@ -0,0 +1,48 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    cpu.hpp
+/// @brief   Runs the firmware on a host thread, with a signal handler standing in for the
+///          MicroBlaze's interrupt.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cstdint>
+
+#include "xparameters.h"
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace sim::cpu {
+
+constexpr uint32_t FREQUENCY = XPAR_CPU_M_AXI_DP_FREQ_HZ;
+
+using Entry = auto (*)() -> int;
+
+/// @brief Holds the simulated hardware still while it exists. Every register access is made in
+///        one so the peripherals are never stepped part way through it. An interrupt that comes
+///        due meanwhile is taken when the outermost one ends, if the firmware has them enabled.
+class Critical {
+public:
+    Critical();
+    ~Critical();
+
+    Critical(const Critical&) = delete;
+    auto operator=(const Critical&) -> Critical& = delete;
+};
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace sim::cpu {
+
+auto boot(Entry entry) -> void;
+
+auto now() -> uint64_t;
+
+auto interrupts_enabled() -> bool;
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
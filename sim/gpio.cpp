@@ -0,0 +1,118 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    gpio.cpp
+/// @brief   Simulated AXI GPIO devices, each with two channels.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include "xgpio.h"
+#include "xgpio_l.h"
+#include "xparameters.h"
+
+#include "gpio.hpp"
+
+/*------------------------------------------------------------------------------------------------*/
+// private variables
+/*------------------------------------------------------------------------------------------------*/
+
+namespace {
+
+constexpr uint32_t CHANNELS = 2;
+
+// Pins are inputs out of reset.
+struct Channel {
+    std::atomic<uint32_t> data{0};
+    std::atomic<uint32_t> tristate{UINT32_MAX};
+    std::atomic<uint32_t> inputs{0};
+    std::atomic<uint32_t> writes{0};
+};
+
+std::array<std::array<Channel, CHANNELS>, sim::gpio::COUNT> devices{};
+
+std::array<XGpio_Config, sim::gpio::COUNT> configs{{
+    {XPAR_GPIO_0_DEVICE_ID, XPAR_GPIO_0_BASEADDR, 0, XPAR_GPIO_0_IS_DUAL},
+    {XPAR_GPIO_1_DEVICE_ID, XPAR_GPIO_1_BASEADDR, 0, XPAR_GPIO_1_IS_DUAL},
+    {XPAR_GPIO_2_DEVICE_ID, XPAR_GPIO_2_BASEADDR, 0, XPAR_GPIO_2_IS_DUAL},
+    {XPAR_GPIO_3_DEVICE_ID, XPAR_GPIO_3_BASEADDR, 0, XPAR_GPIO_3_IS_DUAL},
+    {XPAR_GPIO_4_DEVICE_ID, XPAR_GPIO_4_BASEADDR, 0, XPAR_GPIO_4_IS_DUAL},
+}};
+
+auto port_at(const uint16_t device, const uint32_t offset) -> Channel& {
+    return devices[device][offset / XGPIO_CHAN_OFFSET];
+}
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// host side
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief What the firmware last wrote to a channel's data register. Channels count from 1, as
+///        the driver does.
+auto sim::gpio::output(const uint16_t device, const uint8_t channel) -> uint32_t {
+    return devices[device][channel - 1U].data.load(std::memory_order_relaxed);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Number of times the firmware has written a channel's data register.
+auto sim::gpio::writes(const uint16_t device, const uint8_t channel) -> uint32_t {
+    return devices[device][channel - 1U].writes.load(std::memory_order_relaxed);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Drive a channel's input pins.
+auto sim::gpio::set_input(const uint16_t device, const uint8_t channel, const uint32_t value)
+    -> void {
+    devices[device][channel - 1U].inputs.store(value, std::memory_order_relaxed);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// hardware side
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Input pins read what's driven on them and output pins what was last written.
+auto sim::gpio::read(const uint16_t device, const uint32_t offset) -> uint32_t {
+    auto& port = port_at(device, offset);
+    const auto tristate = port.tristate.load(std::memory_order_relaxed);
+
+    switch(offset % XGPIO_CHAN_OFFSET) {
+        case XGPIO_DATA_OFFSET: {
+            return (port.inputs.load(std::memory_order_relaxed) & tristate)
+                 | (port.data.load(std::memory_order_relaxed) & ~tristate);
+        }
+        case XGPIO_TRI_OFFSET: return tristate;
+        default: return 0;
+    }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto sim::gpio::write(const uint16_t device, const uint32_t offset, const uint32_t value) -> void {
+    auto& port = port_at(device, offset);
+
+    switch(offset % XGPIO_CHAN_OFFSET) {
+        case XGPIO_DATA_OFFSET: {
+            port.data.store(value, std::memory_order_relaxed);
+            port.writes.fetch_add(1, std::memory_order_relaxed);
+            break;
+        }
+        case XGPIO_TRI_OFFSET: port.tristate.store(value, std::memory_order_relaxed); break;
+        default: break;
+    }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// BSP driver
+/*------------------------------------------------------------------------------------------------*/
+
+XGpio_Config* XGpio_LookupConfig(const u16 DeviceId) {
+    return (DeviceId < configs.size()) ? &configs[DeviceId] : nullptr;
+}
+
+/*------------------------------------------------------------------------------------------------*/
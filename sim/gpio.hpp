@@ -0,0 +1,57 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    gpio.hpp
+/// @brief   Simulated AXI GPIO devices, each with two channels.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "xil_types.h"
+#include "xparameters.h"
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace sim::gpio {
+
+constexpr uint32_t COUNT = XPAR_XGPIO_NUM_INSTANCES;
+
+/// @brief Indexed by device ID.
+constexpr std::array<UINTPTR, COUNT> BASE_ADDRESSES{
+    XPAR_GPIO_0_BASEADDR,
+    XPAR_GPIO_1_BASEADDR,
+    XPAR_GPIO_2_BASEADDR,
+    XPAR_GPIO_3_BASEADDR,
+    XPAR_GPIO_4_BASEADDR,
+};
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// host side
+/*------------------------------------------------------------------------------------------------*/
+
+namespace sim::gpio {
+
+auto output(uint16_t device, uint8_t channel) -> uint32_t;
+
+auto writes(uint16_t device, uint8_t channel) -> uint32_t;
+
+auto set_input(uint16_t device, uint8_t channel, uint32_t value) -> void;
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// hardware side
+/*------------------------------------------------------------------------------------------------*/
+
+namespace sim::gpio {
+
+auto read(uint16_t device, uint32_t offset) -> uint32_t;
+auto write(uint16_t device, uint32_t offset, uint32_t value) -> void;
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
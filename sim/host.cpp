@@ -0,0 +1,592 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    host.cpp
+/// @brief   The PC end of the link, for tests and benchmarks to drive the simulated analyser.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <variant>
+#include <vector>
+
+#include "cpu.hpp"
+#include "host.hpp"
+#include "uartlite.hpp"
+
+/// The firmware's main(), renamed when it's built for the host.
+auto firmware_main() -> int;
+
+/*------------------------------------------------------------------------------------------------*/
+// private variables
+/*------------------------------------------------------------------------------------------------*/
+
+namespace {
+
+constexpr uint8_t FRAME_START = 0x02;
+constexpr uint8_t FRAME_END = 0x03;
+constexpr uint8_t ESCAPE = 0x1B;
+constexpr uint8_t COBS_DELIMITER = 0x00;
+
+constexpr auto POLL_INTERVAL = std::chrono::microseconds(50);
+
+// Startup sends a few hundred bytes of banner, well inside a second of simulated time.
+constexpr uint64_t BOOT_CYCLES = sim::cpu::FREQUENCY;
+constexpr std::string_view BOOT_TEXT = "Startup complete";
+
+enum class State {
+    Outside,
+    Frame,
+    Escaped,
+    Trailer,
+};
+
+// Only used by the harness's thread.
+bool cobs{false};
+State state{State::Outside};
+std::vector<uint8_t> frame{};
+std::string text{};
+uint32_t trailer{0};
+uint64_t received_bytes{0};
+std::deque<sim::host::Output> outputs{};
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// private functions
+/*------------------------------------------------------------------------------------------------*/
+
+namespace {
+
+auto pump() -> void;
+auto receive(sim::uartlite::Wire wire) -> void;
+auto receive_text(sim::uartlite::Wire wire) -> void;
+auto finish_frame(std::span<const uint8_t> data, uint64_t time) -> void;
+
+auto cobs_decode(std::span<const uint8_t> data) -> std::optional<std::vector<uint8_t>>;
+
+auto describe(const std::optional<sim::host::Output>& output) -> std::string;
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// link
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Start the firmware and wait for it to finish starting up. The wait is in simulated time,
+///        which only passes while the firmware's thread runs, so a busy host can't time it out.
+auto sim::host::boot() -> void {
+    cpu::boot(firmware_main);
+
+    const auto deadline = cpu::now() + BOOT_CYCLES;
+    while(cpu::now() < deadline) {
+        const auto output = next(1ms);
+        if(!output) {
+            continue;
+        }
+
+        if(const auto* const received = std::get_if<Text>(&output.value());
+           received != nullptr && received->text == BOOT_TEXT) {
+            return;
+        }
+    }
+
+    std::fprintf(stderr,
+                 "timed out waiting for \"%.*s\"\n",
+                 static_cast<int>(BOOT_TEXT.size()),
+                 BOOT_TEXT.data());
+    exit(EXIT_FAILURE);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Frame commands, and read frames, with COBS rather than escaping from now on. Anything
+///        the firmware sent before should already have been read.
+auto sim::host::set_cobs(const bool enable) -> void {
+    cobs = enable;
+    state = State::Outside;
+    frame.clear();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto sim::host::send(const uint8_t opcode, std::span<const uint8_t> argument) -> void {
+    std::vector<uint8_t> bytes{};
+
+    if(cobs) {
+        std::vector<uint8_t> block{opcode};
+        block.insert(block.end(), argument.begin(), argument.end());
+
+        bytes.push_back(COBS_DELIMITER);
+        size_t code_index = bytes.size();
+        bytes.push_back(0);
+        uint8_t code = 1;
+        for(const auto byte : block) {
+            if(byte != 0) {
+                bytes.push_back(byte);
+                code++;
+            }
+            if(byte == 0 || code == 0xFF) {
+                bytes[code_index] = code;
+                code_index = bytes.size();
+                bytes.push_back(0);
+                code = 1;
+            }
+        }
+        bytes[code_index] = code;
+        bytes.push_back(COBS_DELIMITER);
+    } else {
+        bytes.push_back(FRAME_START);
+        bytes.push_back(opcode);
+        for(const auto byte : argument) {
+            if(byte == FRAME_START || byte == FRAME_END || byte == ESCAPE) {
+                bytes.push_back(ESCAPE);
+            }
+            bytes.push_back(byte);
+        }
+        bytes.push_back(FRAME_END);
+    }
+
+    send_raw(bytes);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Send a command with the low argument_bytes of argument, little endian.
+auto sim::host::send(const uint8_t opcode, const uint32_t argument, const uint32_t argument_bytes)
+    -> void {
+    std::vector<uint8_t> bytes{};
+    for(uint32_t i = 0; i < argument_bytes; i++) {
+        bytes.push_back(static_cast<uint8_t>(argument >> (i * 8)));
+    }
+    send(opcode, bytes);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Send bytes as they are. Reads while the wire's busy so the firmware never waits on us.
+auto sim::host::send_raw(std::span<const uint8_t> bytes) -> void {
+    for(const auto byte : bytes) {
+        while(!uartlite::send(byte)) {
+            pump();
+            std::this_thread::sleep_for(POLL_INTERVAL);
+        }
+    }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief The next frame or line of text the firmware sends.
+/// @return std::nullopt if nothing arrives within timeout.
+auto sim::host::next(const std::chrono::milliseconds timeout) -> std::optional<Output> {
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+
+    while(true) {
+        pump();
+        if(!outputs.empty()) {
+            auto output = std::move(outputs.front());
+            outputs.pop_front();
+            return output;
+        }
+
+        if(std::chrono::steady_clock::now() >= deadline) {
+            return std::nullopt;
+        }
+        std::this_thread::sleep_for(POLL_INTERVAL);
+    }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Fails unless the next thing sent is a frame with opcode.
+auto sim::host::expect_frame(const uint8_t opcode) -> Frame {
+    const auto output = next();
+    const auto* const received = output ? std::get_if<Frame>(&output.value()) : nullptr;
+    if(received == nullptr || received->opcode != opcode) {
+        std::fprintf(stderr,
+                     "expected frame '%c', got %s\n",
+                     static_cast<char>(opcode),
+                     describe(output).c_str());
+        exit(EXIT_FAILURE);
+    }
+    return *received;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Fails unless the next thing sent is the line of text.
+auto sim::host::expect_text(const std::string_view expected) -> Text {
+    const auto output = next();
+    const auto* const received = output ? std::get_if<Text>(&output.value()) : nullptr;
+    if(received == nullptr || received->text != expected) {
+        std::fprintf(stderr,
+                     "expected \"%.*s\", got %s\n",
+                     static_cast<int>(expected.size()),
+                     expected.data(),
+                     describe(output).c_str());
+        exit(EXIT_FAILURE);
+    }
+    return *received;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Skip everything up to the line of text.
+auto sim::host::wait_text(const std::string_view expected) -> Text {
+    while(true) {
+        const auto output = next();
+        if(!output) {
+            std::fprintf(stderr,
+                         "timed out waiting for \"%.*s\"\n",
+                         static_cast<int>(expected.size()),
+                         expected.data());
+            exit(EXIT_FAILURE);
+        }
+
+        if(const auto* const received = std::get_if<Text>(&output.value());
+           received != nullptr && received->text == expected) {
+            return *received;
+        }
+    }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Fails if the firmware sends anything within time.
+auto sim::host::expect_quiet(const std::chrono::milliseconds time) -> void {
+    if(const auto output = next(time); output) {
+        std::fprintf(stderr, "expected nothing, got %s\n", describe(output).c_str());
+        exit(EXIT_FAILURE);
+    }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Bytes received from the firmware so far.
+auto sim::host::received() -> uint64_t {
+    pump();
+    return received_bytes;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// decoding
+/*------------------------------------------------------------------------------------------------*/
+
+auto sim::host::LineDecoder::decode(const Frame& frame) -> Line {
+    Line line{};
+
+    switch(frame.opcode) {
+        // A short raw line leaves the reference blank.
+        case 'U': {
+            check(frame.payload.size() <= line.size(), "raw line fits the head");
+            std::copy(frame.payload.begin(), frame.payload.end(), line.begin());
+            _previous = (frame.payload.size() == line.size()) ? line : Line{};
+            return line;
+        }
+
+        case 'Z': {
+            const auto delta = decode_rle(frame.payload);
+            check(delta.size() == line.size(), "compressed line decodes to the head width");
+            for(uint32_t i = 0; i < line.size(); i++) {
+                line[i] = _previous[i] ^ delta[i];
+            }
+            _previous = line;
+            return line;
+        }
+
+        case 'V': {
+            const auto& payload = frame.payload;
+            check(payload.size() >= 5, "reliable line has a header and CRC");
+
+            const auto body = std::span(payload).first(payload.size() - 2);
+            const auto crc = read_le(std::span(payload).last(2), 2);
+            check(crc16(body) == crc, "reliable line CRC matches");
+
+            const Frame inner{.opcode = body[2],
+                              .payload = std::vector<uint8_t>(body.begin() + 3, body.end()),
+                              .time = frame.time};
+            return decode(inner);
+        }
+
+        default: check(false, "frame is a burn line"); return line;
+    }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Each event's time is the one before it, or the last event of the previous frame, plus
+///        its varint delta. The first frame after recording starts is relative to 0.
+auto sim::host::TimeDecoder::decode(const Frame& frame) -> std::vector<TimedEvent> {
+    check(frame.opcode == 'T', "frame is timestamped events");
+
+    std::vector<TimedEvent> events{};
+    const auto& payload = frame.payload;
+    size_t index = 0;
+
+    while(index < payload.size()) {
+        const auto code = payload[index++];
+
+        uint64_t delta = 0;
+        uint32_t shift = 0;
+        while(true) {
+            check(index < payload.size() && shift < 35, "varint is complete");
+            const auto byte = payload[index++];
+            delta |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            shift += 7;
+            if((byte & 0x80) == 0) {
+                break;
+            }
+        }
+
+        _reference += delta;
+        events.push_back(TimedEvent{.code = code, .time = _reference});
+    }
+
+    return events;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Undo the run length encoding of a compressed line.
+auto sim::host::decode_rle(std::span<const uint8_t> data) -> std::vector<uint8_t> {
+    constexpr uint8_t RUN_FLAG = 0x80;
+    constexpr uint8_t COUNT_MASK = 0x7F;
+
+    std::vector<uint8_t> output{};
+    size_t index = 0;
+
+    while(index < data.size()) {
+        const auto control = data[index++];
+        const uint32_t count = (control & COUNT_MASK) + 1U;
+
+        if((control & RUN_FLAG) != 0) {
+            check(index < data.size(), "run has its byte");
+            output.insert(output.end(), count, data[index++]);
+        } else {
+            check(index + count <= data.size(), "literals are all there");
+            output.insert(output.end(), data.begin() + static_cast<ptrdiff_t>(index),
+                          data.begin() + static_cast<ptrdiff_t>(index + count));
+            index += count;
+        }
+    }
+
+    return output;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto sim::host::decode_event_block(const Frame& frame) -> std::vector<EventRun> {
+    check(frame.opcode == 'E' && frame.payload.size() % 2 == 0, "frame is an event block");
+
+    std::vector<EventRun> runs{};
+    for(size_t i = 0; i < frame.payload.size(); i += 2) {
+        runs.push_back(EventRun{.code = frame.payload[i], .count = frame.payload[i + 1]});
+    }
+    return runs;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto sim::host::read_le(std::span<const uint8_t> data, const uint32_t bytes) -> uint64_t {
+    uint64_t value = 0;
+    for(uint32_t i = 0; i < bytes; i++) {
+        value |= static_cast<uint64_t>(data[i]) << (i * 8);
+    }
+    return value;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief CRC-16/CCITT-FALSE, a bit at a time so it doesn't share the firmware's table.
+auto sim::host::crc16(std::span<const uint8_t> data) -> uint16_t {
+    uint16_t crc = 0xFFFF;
+    for(const auto byte : data) {
+        crc = static_cast<uint16_t>(crc ^ (byte << 8));
+        for(uint32_t bit = 0; bit < 8; bit++) {
+            crc = static_cast<uint16_t>((crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1);
+        }
+    }
+    return crc;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// results
+/*------------------------------------------------------------------------------------------------*/
+
+auto sim::host::check(const bool condition, const std::string_view what) -> void {
+    if(!condition) {
+        std::fprintf(stderr, "check failed: %.*s\n", static_cast<int>(what.size()), what.data());
+        exit(EXIT_FAILURE);
+    }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Exit without waiting for the firmware, which never returns.
+auto sim::host::exit(const int status) -> void {
+    std::fflush(nullptr);
+    std::_Exit(status);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// private functions
+/*------------------------------------------------------------------------------------------------*/
+
+namespace {
+
+auto pump() -> void {
+    while(const auto wire = sim::uartlite::receive()) {
+        received_bytes++;
+        receive(wire.value());
+    }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto receive(const sim::uartlite::Wire wire) -> void {
+    const auto byte = wire.byte;
+
+    if(cobs) {
+        if(state == State::Outside) {
+            if(byte == COBS_DELIMITER) {
+                state = State::Frame;
+                frame.clear();
+            } else {
+                receive_text(wire);
+            }
+            return;
+        }
+
+        // Back to back delimiters are padding.
+        if(byte != COBS_DELIMITER) {
+            frame.push_back(byte);
+        } else if(!frame.empty()) {
+            const auto decoded = cobs_decode(frame);
+            sim::host::check(decoded.has_value() && !decoded->empty(), "COBS frame decodes");
+            finish_frame(decoded.value(), wire.time);
+            state = State::Outside;
+        }
+        return;
+    }
+
+    switch(state) {
+        case State::Outside: {
+            if(byte == FRAME_START) {
+                state = State::Frame;
+                frame.clear();
+            } else {
+                receive_text(wire);
+            }
+            break;
+        }
+
+        case State::Frame: {
+            if(byte == ESCAPE) {
+                state = State::Escaped;
+            } else if(byte == FRAME_END) {
+                sim::host::check(!frame.empty(), "frame has an opcode");
+                state = State::Trailer;
+                trailer = 0;
+            } else if(byte == FRAME_START) {
+                frame.clear();
+            } else {
+                frame.push_back(byte);
+            }
+            break;
+        }
+
+        case State::Escaped: {
+            frame.push_back(byte);
+            state = State::Frame;
+            break;
+        }
+
+        case State::Trailer: {
+            constexpr std::string_view TRAILER = "\r\n";
+            sim::host::check(byte == TRAILER[trailer], "frame ends with CR LF");
+            // Only finished once the trailer's in, so switching framing can't split it.
+            if(++trailer == TRAILER.size()) {
+                finish_frame(frame, wire.time);
+                state = State::Outside;
+            }
+            break;
+        }
+    }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Collect text up to CR LF. Blank lines are dropped.
+auto receive_text(const sim::uartlite::Wire wire) -> void {
+    text.push_back(static_cast<char>(wire.byte));
+
+    if(text.ends_with("\r\n")) {
+        text.resize(text.size() - 2);
+        if(!text.empty()) {
+            outputs.emplace_back(sim::host::Text{.text = text, .time = wire.time});
+        }
+        text.clear();
+    }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto finish_frame(std::span<const uint8_t> data, const uint64_t time) -> void {
+    outputs.emplace_back(sim::host::Frame{.opcode = data.front(),
+                                          .payload = std::vector<uint8_t>(data.begin() + 1,
+                                                                          data.end()),
+                                          .time = time});
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto cobs_decode(std::span<const uint8_t> data) -> std::optional<std::vector<uint8_t>> {
+    std::vector<uint8_t> output{};
+    size_t index = 0;
+
+    while(index < data.size()) {
+        const uint8_t code = data[index++];
+        if(code == 0 || index + code - 1 > data.size()) {
+            return std::nullopt;
+        }
+
+        output.insert(output.end(), data.begin() + static_cast<ptrdiff_t>(index),
+                      data.begin() + static_cast<ptrdiff_t>(index + code - 1));
+        index += code - 1U;
+
+        if(code != 0xFF && index != data.size()) {
+            output.push_back(0);
+        }
+    }
+
+    return output;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto describe(const std::optional<sim::host::Output>& output) -> std::string {
+    if(!output) {
+        return "nothing";
+    }
+
+    if(const auto* const text_line = std::get_if<sim::host::Text>(&output.value())) {
+        return "\"" + text_line->text + "\"";
+    }
+
+    const auto& received = std::get<sim::host::Frame>(output.value());
+    return "frame '" + std::string(1, static_cast<char>(received.opcode)) + "' of "
+         + std::to_string(received.payload.size()) + " bytes";
+}
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,143 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    host.hpp
+/// @brief   The PC end of the link, for tests and benchmarks to drive the simulated analyser.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include "mech.hpp"
+
+/*------------------------------------------------------------------------------------------------*/
+// types
+/*------------------------------------------------------------------------------------------------*/
+
+namespace sim::host {
+
+using namespace std::chrono_literals;
+
+/// @brief How long to wait for the firmware to send something before giving up.
+constexpr auto TIMEOUT = 5s;
+
+/// @brief A frame received and when its last byte finished arriving, in simulated cycles.
+struct Frame {
+    uint8_t opcode;
+    std::vector<uint8_t> payload;
+    uint64_t time;
+};
+
+/// @brief A line of text received outside a frame, without its CR LF.
+struct Text {
+    std::string text;
+    uint64_t time;
+};
+
+using Output = std::variant<Frame, Text>;
+
+using Line = std::array<uint8_t, mech::HEAD_BYTES>;
+
+/// @brief An event from a timestamped frame with its absolute time, in timer cycles.
+struct TimedEvent {
+    uint8_t code;
+    uint64_t time;
+};
+
+/// @brief A run of motor events from an event block.
+struct EventRun {
+    uint8_t code;
+    uint8_t count;
+};
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// link
+/*------------------------------------------------------------------------------------------------*/
+
+namespace sim::host {
+
+auto boot() -> void;
+
+auto set_cobs(bool enable) -> void;
+
+auto send(uint8_t opcode, std::span<const uint8_t> argument = {}) -> void;
+auto send(uint8_t opcode, uint32_t argument, uint32_t argument_bytes) -> void;
+auto send_raw(std::span<const uint8_t> bytes) -> void;
+
+auto next(std::chrono::milliseconds timeout = TIMEOUT) -> std::optional<Output>;
+
+auto expect_frame(uint8_t opcode) -> Frame;
+auto expect_text(std::string_view text) -> Text;
+auto wait_text(std::string_view text) -> Text;
+auto expect_quiet(std::chrono::milliseconds time) -> void;
+
+auto received() -> uint64_t;
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// decoding
+/*------------------------------------------------------------------------------------------------*/
+
+namespace sim::host {
+
+/// @brief Rebuilds burn lines from 'U', 'Z' and 'V' frames, keeping the previous line to undo
+///        delta encoding against, as the firmware does.
+class LineDecoder {
+public:
+    auto decode(const Frame& frame) -> Line;
+
+    auto reset() -> void {
+        _previous = {};
+    }
+
+private:
+    Line _previous{};
+};
+
+/// @brief Rebuilds absolute times from the deltas in 'T' frames.
+class TimeDecoder {
+public:
+    auto decode(const Frame& frame) -> std::vector<TimedEvent>;
+
+    auto reset() -> void {
+        _reference = 0;
+    }
+
+private:
+    uint64_t _reference{0};
+};
+
+auto decode_rle(std::span<const uint8_t> data) -> std::vector<uint8_t>;
+
+auto decode_event_block(const Frame& frame) -> std::vector<EventRun>;
+
+auto read_le(std::span<const uint8_t> data, uint32_t bytes) -> uint64_t;
+
+auto crc16(std::span<const uint8_t> data) -> uint16_t;
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// results
+/*------------------------------------------------------------------------------------------------*/
+
+namespace sim::host {
+
+auto check(bool condition, std::string_view what) -> void;
+
+[[noreturn]] auto exit(int status) -> void;
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,23 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    mb_interface.h
+/// @brief   Host stand-in for the MicroBlaze interrupt enable, MSR and register access.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <xil_types.h>
+
+void microblaze_enable_interrupts(void);
+void microblaze_disable_interrupts(void);
+
+/// @brief The simulated machine status register. Only the interrupt enable bit is modelled.
+u32 sim_mfmsr(void);
+
+#define mfmsr() sim_mfmsr()
+
+/// @brief The address the current interrupt will return to, as r14 holds inside an ISR. On the host
+///        it's where the signal that's being serviced interrupted the firmware's thread.
+UINTPTR sim_mfgpr_r14(void);
+
+#define mfgpr(rn) sim_mfgpr_##rn()
@@ -0,0 +1,21 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    xgpio.h
+/// @brief   Host stand-in for the AXI GPIO driver's configuration lookup.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <xgpio_l.h>
+#include <xil_types.h>
+#include <xparameters.h>
+#include <xstatus.h>
+
+typedef struct {
+    u16 DeviceId;
+    UINTPTR BaseAddress;
+    int InterruptPresent;
+    int IsDual;
+} XGpio_Config;
+
+XGpio_Config* XGpio_LookupConfig(u16 DeviceId);
@@ -0,0 +1,16 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    xgpio_l.h
+/// @brief   Host stand-in for the AXI GPIO register map.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <xil_io.h>
+
+#define XGPIO_DATA_OFFSET 0x0
+#define XGPIO_TRI_OFFSET 0x4
+#define XGPIO_DATA2_OFFSET 0x8
+#define XGPIO_TRI2_OFFSET 0xC
+
+#define XGPIO_CHAN_OFFSET 8
@@ -0,0 +1,19 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    xil_exception.h
+/// @brief   Host stand-in for the BSP's exception table.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <xil_types.h>
+
+#define XIL_EXCEPTION_ID_INT 16U
+
+typedef void (*Xil_ExceptionHandler)(void* Data);
+typedef void (*XInterruptHandler)(void* InstancePtr);
+
+void Xil_ExceptionInit(void);
+void Xil_ExceptionRegisterHandler(u32 Id, Xil_ExceptionHandler Handler, void* Data);
+void Xil_ExceptionEnable(void);
+void Xil_ExceptionDisable(void);
@@ -0,0 +1,12 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    xil_io.h
+/// @brief   Host stand-in routing register accesses to the simulated peripherals.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <xil_types.h>
+
+u32 Xil_In32(UINTPTR Addr);
+void Xil_Out32(UINTPTR Addr, u32 Value);
@@ -0,0 +1,18 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    xil_types.h
+/// @brief   Host stand-in for the BSP's basic types.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cstdint>
+
+using u8 = uint8_t;
+using u16 = uint16_t;
+using u32 = uint32_t;
+using u64 = uint64_t;
+using s32 = int32_t;
+using UINTPTR = uintptr_t;
+
+#define XIL_COMPONENT_IS_READY 0x11111111U
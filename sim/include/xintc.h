@@ -0,0 +1,36 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    xintc.h
+/// @brief   Host stand-in for the AXI interrupt controller driver.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <xil_exception.h>
+#include <xil_types.h>
+#include <xparameters.h>
+#include <xstatus.h>
+
+#define XIN_SIMULATION_MODE 0
+#define XIN_REAL_MODE 1
+
+typedef void (*XFastInterruptHandler)(void);
+
+typedef struct {
+    UINTPTR BaseAddress;
+    u32 IsReady;
+    u32 IsStarted;
+} XIntc;
+
+int XIntc_Initialize(XIntc* InstancePtr, u16 DeviceId);
+int XIntc_SelfTest(XIntc* InstancePtr);
+int XIntc_Start(XIntc* InstancePtr, u8 Mode);
+
+int XIntc_Connect(XIntc* InstancePtr, u8 Id, XInterruptHandler Handler, void* CallBackRef);
+int XIntc_ConnectFastHandler(XIntc* InstancePtr, u8 Id, XFastInterruptHandler Handler);
+
+void XIntc_Enable(XIntc* InstancePtr, u8 Id);
+void XIntc_Disable(XIntc* InstancePtr, u8 Id);
+void XIntc_Acknowledge(XIntc* InstancePtr, u8 Id);
+
+void XIntc_InterruptHandler(XIntc* InstancePtr);
@@ -0,0 +1,63 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    xllfifo.h
+/// @brief   Host stand-in for the AXI-Stream FIFO driver, AXI4-Lite data interface only.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <xil_io.h>
+#include <xil_types.h>
+#include <xparameters.h>
+#include <xstatus.h>
+
+#define XLLF_ISR_OFFSET 0x00
+#define XLLF_IER_OFFSET 0x04
+#define XLLF_RDFR_OFFSET 0x18
+#define XLLF_RDFO_OFFSET 0x1c
+#define XLLF_RDFD_OFFSET 0x20
+#define XLLF_RLF_OFFSET 0x24
+
+#define XLLF_INT_RPURE_MASK 0x80000000
+#define XLLF_INT_RPORE_MASK 0x40000000
+#define XLLF_INT_RPUE_MASK 0x20000000
+#define XLLF_INT_RC_MASK 0x04000000
+#define XLLF_INT_ALL_MASK 0xfff80000
+
+#define XLLF_RLF_MASK 0x003FFFFF
+#define XLLF_RDFR_RESET_MASK 0x000000a5
+
+typedef struct {
+    u32 DeviceId;
+    UINTPTR BaseAddress;
+    UINTPTR Axi4BaseAddress;
+    u32 Datainterface;
+} XLlFifo_Config;
+
+typedef struct {
+    UINTPTR BaseAddress;
+    u32 IsReady;
+    UINTPTR Axi4BaseAddress;
+    u32 Datainterface;
+} XLlFifo;
+
+// The BSP really does spell it this way.
+XLlFifo_Config* XLlFfio_LookupConfig(u32 DeviceId);
+int XLlFifo_CfgInitialize(XLlFifo* InstancePtr, XLlFifo_Config* Config, UINTPTR EffectiveAddress);
+
+#define XLlFifo_Status(InstancePtr) Xil_In32((InstancePtr)->BaseAddress + XLLF_ISR_OFFSET)
+
+#define XLlFifo_IntClear(InstancePtr, Mask) \
+    Xil_Out32((InstancePtr)->BaseAddress + XLLF_ISR_OFFSET, (u32)((Mask) & XLLF_INT_ALL_MASK))
+
+#define XLlFifo_IntEnable(InstancePtr, Mask) \
+    Xil_Out32((InstancePtr)->BaseAddress + XLLF_IER_OFFSET, \
+              (Xil_In32((InstancePtr)->BaseAddress + XLLF_IER_OFFSET) | (u32)(Mask)) \
+                  & XLLF_INT_ALL_MASK)
+
+#define XLlFifo_iRxOccupancy(InstancePtr) Xil_In32((InstancePtr)->BaseAddress + XLLF_RDFO_OFFSET)
+
+#define XLlFifo_iRxGetLen(InstancePtr) \
+    (Xil_In32((InstancePtr)->BaseAddress + XLLF_RLF_OFFSET) & XLLF_RLF_MASK)
+
+#define XLlFifo_RxGetWord(InstancePtr) Xil_In32((InstancePtr)->BaseAddress + XLLF_RDFD_OFFSET)
@@ -0,0 +1,20 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    xparameters.h
+/// @brief   Host stand-in adding simulator only hardware to the design's parameters.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include_next "xparameters.h"
+
+// The block design has no AXI Timer. The simulator adds one, counter 0 free running at the CPU
+// clock, so timestamps and cycle counts can be tested.
+#define XPAR_TMRCTR_0_BASEADDR 0x41C00000U
+#define XPAR_TMRCTR_0_HIGHADDR 0x41C0FFFFU
+
+// Counter 1's interrupt goes to a ninth controller input, also only in the simulator, so the PC
+// sampler can be tested. Input 8 is already edge triggered in XPAR_INTC_0_KIND_OF_INTR.
+#undef XPAR_INTC_MAX_NUM_INTR_INPUTS
+#define XPAR_INTC_MAX_NUM_INTR_INPUTS 9
+#define XPAR_INTC_0_TMRCTR_0_VEC_ID 8U
@@ -0,0 +1,37 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    xspi.h
+/// @brief   Host stand-in for the AXI SPI driver, polled master transfers only.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <xil_types.h>
+#include <xparameters.h>
+#include <xstatus.h>
+
+#define XSP_MASTER_OPTION 0x1
+
+typedef struct {
+    u16 DeviceId;
+    UINTPTR BaseAddress;
+    int HasFifos;
+    u32 SlaveOnly;
+    u8 NumSlaveBits;
+} XSpi_Config;
+
+typedef struct {
+    UINTPTR BaseAddr;
+    u32 IsReady;
+    u32 IsStarted;
+    u32 Options;
+    u32 SlaveSelectReg;
+} XSpi;
+
+XSpi_Config* XSpi_LookupConfig(u16 DeviceId);
+int XSpi_CfgInitialize(XSpi* InstancePtr, XSpi_Config* Config, UINTPTR EffectiveAddr);
+
+int XSpi_SetOptions(XSpi* InstancePtr, u32 Options);
+int XSpi_Start(XSpi* InstancePtr);
+int XSpi_SetSlaveSelect(XSpi* InstancePtr, u32 SlaveMask);
+int XSpi_Transfer(XSpi* InstancePtr, u8* SendBufPtr, u8* RecvBufPtr, unsigned int ByteCount);
@@ -0,0 +1,11 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    xstatus.h
+/// @brief   Host stand-in for the BSP's status codes.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#define XST_SUCCESS 0
+#define XST_FAILURE 1
+#define XST_DEVICE_NOT_FOUND 2
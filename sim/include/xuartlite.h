@@ -0,0 +1,58 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    xuartlite.h
+/// @brief   Host stand-in for the UART Lite driver.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <xil_types.h>
+#include <xparameters.h>
+#include <xstatus.h>
+#include <xuartlite_l.h>
+
+typedef void (*XUartLite_Handler)(void* CallBackRef, unsigned int ByteCount);
+
+typedef struct {
+    u16 DeviceId;
+    UINTPTR RegBaseAddr;
+    u32 BaudRate;
+    u8 UseParity;
+    u8 ParityOdd;
+    u8 DataBits;
+} XUartLite_Config;
+
+typedef struct {
+    u8* NextBytePtr;
+    unsigned int RequestedBytes;
+    unsigned int RemainingBytes;
+} XUartLite_Buffer;
+
+typedef struct {
+    UINTPTR RegBaseAddress;
+    u32 IsReady;
+
+    XUartLite_Buffer SendBuffer;
+    XUartLite_Buffer ReceiveBuffer;
+
+    XUartLite_Handler RecvHandler;
+    void* RecvCallBackRef;
+    XUartLite_Handler SendHandler;
+    void* SendCallBackRef;
+} XUartLite;
+
+XUartLite_Config* XUartLite_LookupConfig(u16 DeviceId);
+int XUartLite_CfgInitialize(XUartLite* InstancePtr, XUartLite_Config* Config,
+                            UINTPTR EffectiveAddr);
+
+unsigned int XUartLite_Send(XUartLite* InstancePtr, u8* DataBufferPtr, unsigned int NumBytes);
+
+void XUartLite_SetSendHandler(XUartLite* InstancePtr, XUartLite_Handler FuncPtr,
+                              void* CallBackRef);
+void XUartLite_SetRecvHandler(XUartLite* InstancePtr, XUartLite_Handler FuncPtr,
+                              void* CallBackRef);
+
+void XUartLite_EnableInterrupt(XUartLite* InstancePtr);
+void XUartLite_DisableInterrupt(XUartLite* InstancePtr);
+
+void XUartLite_InterruptHandler(XUartLite* InstancePtr);
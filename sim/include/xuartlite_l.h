@@ -0,0 +1,41 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    xuartlite_l.h
+/// @brief   Host stand-in for the UART Lite register map.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <xil_io.h>
+
+#define XUL_RX_FIFO_OFFSET 0
+#define XUL_TX_FIFO_OFFSET 4
+#define XUL_STATUS_REG_OFFSET 8
+#define XUL_CONTROL_REG_OFFSET 12
+
+#define XUL_CR_ENABLE_INTR 0x10
+#define XUL_CR_FIFO_RX_RESET 0x02
+#define XUL_CR_FIFO_TX_RESET 0x01
+
+#define XUL_SR_OVERRUN_ERROR 0x20
+#define XUL_SR_INTR_ENABLED 0x10
+#define XUL_SR_TX_FIFO_FULL 0x08
+#define XUL_SR_TX_FIFO_EMPTY 0x04
+#define XUL_SR_RX_FIFO_FULL 0x02
+#define XUL_SR_RX_FIFO_VALID_DATA 0x01
+
+#define XUL_FIFO_SIZE 16
+
+#define XUartLite_ReadReg(BaseAddress, RegOffset) Xil_In32((BaseAddress) + (RegOffset))
+#define XUartLite_WriteReg(BaseAddress, RegOffset, Data) \
+    Xil_Out32((BaseAddress) + (RegOffset), (u32)(Data))
+
+#define XUartLite_GetStatusReg(BaseAddress) \
+    XUartLite_ReadReg((BaseAddress), XUL_STATUS_REG_OFFSET)
+
+#define XUartLite_IsReceiveEmpty(BaseAddress) \
+    ((XUartLite_GetStatusReg((BaseAddress)) & XUL_SR_RX_FIFO_VALID_DATA) \
+     != XUL_SR_RX_FIFO_VALID_DATA)
+
+#define XUartLite_IsTransmitFull(BaseAddress) \
+    ((XUartLite_GetStatusReg((BaseAddress)) & XUL_SR_TX_FIFO_FULL) == XUL_SR_TX_FIFO_FULL)
@@ -0,0 +1,167 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    intc.cpp
+/// @brief   Simulated AXI interrupt controller.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <optional>
+
+#include "xintc.h"
+#include "xparameters.h"
+
+#include "intc.hpp"
+
+/*------------------------------------------------------------------------------------------------*/
+// private variables
+/*------------------------------------------------------------------------------------------------*/
+
+namespace {
+
+constexpr uint32_t COUNT = XPAR_INTC_MAX_NUM_INTR_INPUTS;
+
+// Inputs with their bit set are edge triggered, the rest level.
+constexpr uint32_t EDGE_INPUTS = XPAR_INTC_0_KIND_OF_INTR;
+
+struct Vector {
+    XInterruptHandler handler;
+    void* callback_ref;
+    XFastInterruptHandler fast;
+};
+
+// Only touched by the firmware's thread, inside a Critical or the tick handler.
+constinit std::array<Vector, COUNT> vectors{};
+constinit uint32_t status{0};
+constinit uint32_t enabled{0};
+constinit uint32_t levels{0};
+constinit bool started{false};
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// public functions
+/*------------------------------------------------------------------------------------------------*/
+
+auto sim::intc::raise(const uint8_t input) -> void {
+    status |= 1U << input;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto sim::intc::set_level(const uint8_t input, const bool high) -> void {
+    const uint32_t bit = 1U << input;
+    if(high) {
+        levels |= bit;
+        status |= bit;
+    } else {
+        levels &= ~bit;
+    }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto sim::intc::pending() -> bool {
+    return next().has_value();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto sim::intc::next() -> std::optional<uint8_t> {
+    const uint32_t active = status & enabled;
+    if(!started || active == 0) {
+        return std::nullopt;
+    }
+
+    return static_cast<uint8_t>(std::countr_zero(active));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto sim::intc::fast_handler(const uint8_t input) -> XFastInterruptHandler {
+    return vectors[input].fast;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto sim::intc::acknowledge(const uint8_t input) -> void {
+    const uint32_t bit = 1U << input;
+    status &= ~bit;
+    if((EDGE_INPUTS & bit) == 0 && (levels & bit) != 0) {
+        status |= bit;
+    }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// BSP driver
+/*------------------------------------------------------------------------------------------------*/
+
+int XIntc_Initialize(XIntc* InstancePtr, [[maybe_unused]] const u16 DeviceId) {
+    InstancePtr->BaseAddress = XPAR_INTC_0_BASEADDR;
+    InstancePtr->IsReady = XIL_COMPONENT_IS_READY;
+    InstancePtr->IsStarted = 0;
+    return XST_SUCCESS;
+}
+
+int XIntc_SelfTest([[maybe_unused]] XIntc* InstancePtr) {
+    return XST_SUCCESS;
+}
+
+int XIntc_Start(XIntc* InstancePtr, const u8 Mode) {
+    started = (Mode == XIN_REAL_MODE);
+    InstancePtr->IsStarted = XIL_COMPONENT_IS_READY;
+    return XST_SUCCESS;
+}
+
+int XIntc_Connect([[maybe_unused]] XIntc* InstancePtr,
+                  const u8 Id,
+                  const XInterruptHandler Handler,
+                  void* CallBackRef) {
+    vectors[Id] = Vector{.handler = Handler, .callback_ref = CallBackRef, .fast = nullptr};
+    return XST_SUCCESS;
+}
+
+int XIntc_ConnectFastHandler([[maybe_unused]] XIntc* InstancePtr,
+                             const u8 Id,
+                             const XFastInterruptHandler Handler) {
+    vectors[Id] = Vector{.handler = nullptr, .callback_ref = nullptr, .fast = Handler};
+    return XST_SUCCESS;
+}
+
+void XIntc_Enable([[maybe_unused]] XIntc* InstancePtr, const u8 Id) {
+    enabled |= 1U << Id;
+}
+
+void XIntc_Disable([[maybe_unused]] XIntc* InstancePtr, const u8 Id) {
+    enabled &= ~(1U << Id);
+}
+
+void XIntc_Acknowledge([[maybe_unused]] XIntc* InstancePtr, const u8 Id) {
+    sim::intc::acknowledge(Id);
+}
+
+/// @brief Service the highest priority interrupt. Edge triggered inputs are acknowledged before
+///        their handler runs and level ones after, as the real driver does.
+void XIntc_InterruptHandler([[maybe_unused]] XIntc* InstancePtr) {
+    const auto input = sim::intc::next();
+    if(!input) {
+        return;
+    }
+
+    const bool edge = (EDGE_INPUTS & (1U << input.value())) != 0;
+    if(edge) {
+        sim::intc::acknowledge(input.value());
+    }
+
+    if(const auto& vector = vectors[input.value()]; vector.handler != nullptr) {
+        vector.handler(vector.callback_ref);
+    }
+
+    if(!edge) {
+        sim::intc::acknowledge(input.value());
+    }
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,36 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    intc.hpp
+/// @brief   Simulated AXI interrupt controller.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cstdint>
+#include <optional>
+
+#include "xintc.h"
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace sim::intc {
+
+/// @brief Pulse an input. Latched until acknowledged.
+auto raise(uint8_t input) -> void;
+
+/// @brief Drive a level input. Latched while high, and again on acknowledge if still high.
+auto set_level(uint8_t input, bool high) -> void;
+
+auto pending() -> bool;
+
+/// @brief Lowest numbered input pending and enabled, once the controller has been started.
+auto next() -> std::optional<uint8_t>;
+
+/// @return nullptr if input goes through the dispatcher.
+auto fast_handler(uint8_t input) -> XFastInterruptHandler;
+
+auto acknowledge(uint8_t input) -> void;
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
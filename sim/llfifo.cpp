@@ -0,0 +1,150 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    llfifo.cpp
+/// @brief   Simulated AXI-Stream FIFO the print mech's burn lines arrive through.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <span>
+
+#include "xllfifo.h"
+#include "xparameters.h"
+
+#include "intc.hpp"
+#include "llfifo.hpp"
+
+/*------------------------------------------------------------------------------------------------*/
+// private variables
+/*------------------------------------------------------------------------------------------------*/
+
+namespace {
+
+constexpr uint8_t INPUT = XPAR_MICROBLAZE_0_AXI_INTC_BURN_BUFFER_INTERRUPT_INTR;
+
+constexpr uint32_t PACKETS = 64;
+
+constinit std::atomic<uint32_t> overflow_count{0};
+
+// Only touched by the firmware's thread, inside a Critical or the tick handler. Indexes are free
+// running.
+constinit std::array<uint32_t, sim::llfifo::DEPTH> words{};
+constinit uint32_t words_in{0};
+constinit uint32_t words_out{0};
+
+// Length in bytes of each packet not yet opened with a read of RLF.
+constinit std::array<uint32_t, PACKETS> lengths{};
+constinit uint32_t lengths_in{0};
+constinit uint32_t lengths_out{0};
+
+constinit uint32_t interrupt_status{0};
+constinit uint32_t interrupt_enable{0};
+
+auto update_interrupt() -> void {
+    sim::intc::set_level(INPUT, (interrupt_status & interrupt_enable) != 0);
+}
+
+XLlFifo_Config config{
+    .DeviceId = XPAR_BURN_BUFFER_DEVICE_ID,
+    .BaseAddress = XPAR_BURN_BUFFER_BASEADDR,
+    .Axi4BaseAddress = XPAR_BURN_BUFFER_AXI4_BASEADDR,
+    .Datainterface = XPAR_BURN_BUFFER_DATA_INTERFACE_TYPE,
+};
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// host side
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Packets that arrived to a full FIFO and were lost.
+auto sim::llfifo::overflows() -> uint32_t {
+    return overflow_count.load(std::memory_order_relaxed);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// hardware side
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Receive a packet from the stream, raising receive complete.
+/// @return false if there wasn't room for all of it. None of it is kept.
+auto sim::llfifo::push_packet(std::span<const uint32_t> packet) -> bool {
+    if(DEPTH - (words_in - words_out) < packet.size() || lengths_in - lengths_out == PACKETS) {
+        overflow_count.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    for(const auto word : packet) {
+        words[words_in++ % DEPTH] = word;
+    }
+    lengths[lengths_in++ % PACKETS] = static_cast<uint32_t>(packet.size_bytes());
+
+    interrupt_status |= XLLF_INT_RC_MASK;
+    update_interrupt();
+    return true;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto sim::llfifo::read(const uint32_t offset) -> uint32_t {
+    switch(offset) {
+        case XLLF_ISR_OFFSET: return interrupt_status;
+        case XLLF_IER_OFFSET: return interrupt_enable;
+        case XLLF_RDFO_OFFSET: return words_in - words_out;
+
+        case XLLF_RDFD_OFFSET: return (words_in == words_out) ? 0 : words[words_out++ % DEPTH];
+
+        // Opens the next packet.
+        case XLLF_RLF_OFFSET: {
+            return (lengths_in == lengths_out) ? 0 : lengths[lengths_out++ % PACKETS];
+        }
+
+        default: return 0;
+    }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto sim::llfifo::write(const uint32_t offset, const uint32_t value) -> void {
+    switch(offset) {
+        // Write one to clear.
+        case XLLF_ISR_OFFSET: interrupt_status &= ~value; break;
+        case XLLF_IER_OFFSET: interrupt_enable = value; break;
+
+        case XLLF_RDFR_OFFSET: {
+            if(value == XLLF_RDFR_RESET_MASK) {
+                words_out = words_in;
+                lengths_out = lengths_in;
+            }
+            break;
+        }
+
+        default: break;
+    }
+
+    update_interrupt();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// BSP driver
+/*------------------------------------------------------------------------------------------------*/
+
+XLlFifo_Config* XLlFfio_LookupConfig(const u32 DeviceId) {
+    return (DeviceId == config.DeviceId) ? &config : nullptr;
+}
+
+int XLlFifo_CfgInitialize(XLlFifo* InstancePtr,
+                          XLlFifo_Config* Config,
+                          const UINTPTR EffectiveAddress) {
+    InstancePtr->BaseAddress = EffectiveAddress;
+    InstancePtr->Axi4BaseAddress = Config->Axi4BaseAddress;
+    InstancePtr->Datainterface = Config->Datainterface;
+    InstancePtr->IsReady = XIL_COMPONENT_IS_READY;
+
+    Xil_Out32(EffectiveAddress + XLLF_RDFR_OFFSET, XLLF_RDFR_RESET_MASK);
+    return XST_SUCCESS;
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,44 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    llfifo.hpp
+/// @brief   Simulated AXI-Stream FIFO the print mech's burn lines arrive through.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace sim::llfifo {
+
+/// @brief Receive FIFO depth in words. The block design doesn't say, so this is the IP's default.
+constexpr uint32_t DEPTH = 512;
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// host side
+/*------------------------------------------------------------------------------------------------*/
+
+namespace sim::llfifo {
+
+auto overflows() -> uint32_t;
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// hardware side
+/*------------------------------------------------------------------------------------------------*/
+
+namespace sim::llfifo {
+
+auto push_packet(std::span<const uint32_t> words) -> bool;
+
+auto read(uint32_t offset) -> uint32_t;
+auto write(uint32_t offset, uint32_t value) -> void;
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,157 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    print_mech.cpp
+/// @brief   Scripted print mechanism driving the motor and head interrupts and the burn buffer.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
+
+#include "xparameters.h"
+
+#include "channel.hpp"
+#include "intc.hpp"
+#include "llfifo.hpp"
+#include "print_mech.hpp"
+
+/*------------------------------------------------------------------------------------------------*/
+// private variables
+/*------------------------------------------------------------------------------------------------*/
+
+namespace {
+
+constexpr uint8_t ADVANCE = XPAR_MICROBLAZE_0_AXI_INTC_STEPPER_MOTOR_LINE_ADVANCE_TICK_INTR;
+constexpr uint8_t REVERSE = XPAR_MICROBLAZE_0_AXI_INTC_STEPPER_MOTOR_LINE_REVERSE_TICK_INTR;
+constexpr uint8_t HEAD_START = XPAR_MICROBLAZE_0_AXI_INTC_THERMAL_HEAD_HEAD_ACTIVE_START_TICK_INTR;
+constexpr uint8_t HEAD_END = XPAR_MICROBLAZE_0_AXI_INTC_THERMAL_HEAD_HEAD_ACTIVE_END_TICK_INTR;
+
+// Handed from the host to the firmware's thread, which hands back finished once it's run.
+constinit std::atomic<const sim::print_mech::Script*> pending{nullptr};
+constinit std::atomic<bool> finished{true};
+
+// Every interrupt raised, for checking and measuring what the firmware makes of them.
+constinit sim::Channel<sim::print_mech::Raised, 1024> raised_log{};
+
+// Only touched by the firmware's thread, in the tick handler.
+constinit const sim::print_mech::Script* script{nullptr};
+constinit size_t step_index{0};
+constinit uint64_t next_at{0};
+constinit bool burning{false};
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto sim::print_mech::advance(const uint32_t delay) -> Step {
+    return Step{.kind = Kind::Advance, .delay = delay, .burn = 0, .data = {}};
+}
+
+auto sim::print_mech::reverse(const uint32_t delay) -> Step {
+    return Step{.kind = Kind::Reverse, .delay = delay, .burn = 0, .data = {}};
+}
+
+auto sim::print_mech::line(std::span<const uint8_t, mech::HEAD_BYTES> data,
+                           const uint32_t delay,
+                           const uint32_t burn) -> Step {
+    Step step{.kind = Kind::Line, .delay = delay, .burn = burn, .data = {}};
+    std::copy(data.begin(), data.end(), step.data.begin());
+    return step;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// host side
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Start running a script, its first step counted from now. It must stay valid until
+///        done() and only one can run at a time.
+auto sim::print_mech::run(const Script& new_script) -> void {
+    finished.store(false, std::memory_order_relaxed);
+    pending.store(&new_script, std::memory_order_release);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto sim::print_mech::done() -> bool {
+    return finished.load(std::memory_order_acquire);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief The oldest interrupt raised not yet asked about. Past 1024 waiting, newer ones aren't
+///        recorded.
+auto sim::print_mech::raised() -> std::optional<Raised> {
+    return raised_log.pop();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// hardware side
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Do the next step if it's due by time.
+/// @return false if nothing was due.
+auto sim::print_mech::step(const uint64_t time) -> bool {
+    if(script == nullptr) {
+        script = pending.exchange(nullptr, std::memory_order_acquire);
+        if(script == nullptr) {
+            return false;
+        }
+
+        step_index = 0;
+        burning = false;
+        next_at = time + (script->empty() ? 0 : script->front().delay);
+    }
+
+    if(step_index == script->size()) {
+        script = nullptr;
+        finished.store(true, std::memory_order_release);
+        return false;
+    }
+
+    if(next_at > time) {
+        return false;
+    }
+
+    const auto& current = (*script)[step_index];
+
+    if(current.kind == Kind::Line && !burning) {
+        std::array<uint32_t, mech::HEAD_WORDS> words{};
+        std::memcpy(words.data(), current.data.data(), current.data.size());
+        llfifo::push_packet(words);
+        intc::raise(HEAD_START);
+        raised_log.push(Raised{.signal = Signal::HeadOn, .time = time});
+
+        burning = true;
+        next_at += current.burn;
+        return true;
+    }
+
+    switch(current.kind) {
+        case Kind::Advance:
+            intc::raise(ADVANCE);
+            raised_log.push(Raised{.signal = Signal::Advance, .time = time});
+            break;
+        case Kind::Reverse:
+            intc::raise(REVERSE);
+            raised_log.push(Raised{.signal = Signal::Reverse, .time = time});
+            break;
+        case Kind::Line:
+            intc::raise(HEAD_END);
+            raised_log.push(Raised{.signal = Signal::HeadOff, .time = time});
+            break;
+    }
+
+    burning = false;
+    step_index++;
+    if(step_index != script->size()) {
+        next_at += (*script)[step_index].delay;
+    }
+    return true;
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,82 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    print_mech.hpp
+/// @brief   Scripted print mechanism driving the motor and head interrupts and the burn buffer.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "mech.hpp"
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace sim::print_mech {
+
+enum class Kind : uint8_t {
+    Advance,
+    Reverse,
+    Line,
+};
+
+/// @brief Something the mech does, delay cycles after the step before it finished. A line is
+///        shifted into the burn buffer and the head turned on, then off again burn cycles later.
+struct Step {
+    Kind kind;
+    uint32_t delay;
+    uint32_t burn;
+    std::array<uint8_t, mech::HEAD_BYTES> data;
+};
+
+using Script = std::vector<Step>;
+
+/// @brief The interrupts the mech raises.
+enum class Signal : uint8_t {
+    Advance,
+    Reverse,
+    HeadOn,
+    HeadOff,
+};
+
+/// @brief An interrupt raised and when, in cycles.
+struct Raised {
+    Signal signal;
+    uint64_t time;
+};
+
+auto advance(uint32_t delay) -> Step;
+auto reverse(uint32_t delay) -> Step;
+auto line(std::span<const uint8_t, mech::HEAD_BYTES> data, uint32_t delay, uint32_t burn) -> Step;
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// host side
+/*------------------------------------------------------------------------------------------------*/
+
+namespace sim::print_mech {
+
+auto run(const Script& script) -> void;
+
+auto done() -> bool;
+
+auto raised() -> std::optional<Raised>;
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// hardware side
+/*------------------------------------------------------------------------------------------------*/
+
+namespace sim::print_mech {
+
+auto step(uint64_t time) -> bool;
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
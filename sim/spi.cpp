@@ -0,0 +1,104 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    spi.cpp
+/// @brief   Simulated digital potentiometer on the thermistor SPI bus.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <atomic>
+#include <cstdint>
+
+#include "xparameters.h"
+#include "xspi.h"
+
+#include "spi.hpp"
+
+/*------------------------------------------------------------------------------------------------*/
+// private variables
+/*------------------------------------------------------------------------------------------------*/
+
+namespace {
+
+constinit std::atomic<uint8_t> wiper_code{0};
+constinit std::atomic<uint32_t> transfer_count{0};
+
+XSpi_Config config{
+    .DeviceId = XPAR_AXI_SPI_THERMISTOR_DEVICE_ID,
+    .BaseAddress = XPAR_AXI_SPI_THERMISTOR_BASEADDR,
+    .HasFifos = XPAR_AXI_SPI_THERMISTOR_FIFO_EXIST,
+    .SlaveOnly = XPAR_AXI_SPI_THERMISTOR_SPI_SLAVE_ONLY,
+    .NumSlaveBits = XPAR_AXI_SPI_THERMISTOR_NUM_SS_BITS,
+};
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// host side
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Wiper code the potentiometer was last set to. It takes the last byte of a transfer.
+auto sim::spi::wiper() -> uint8_t {
+    return wiper_code.load(std::memory_order_relaxed);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto sim::spi::transfers() -> uint32_t {
+    return transfer_count.load(std::memory_order_relaxed);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// BSP driver
+/*------------------------------------------------------------------------------------------------*/
+
+// Transfers are polled and complete straight away, so the SPI's interrupt never fires.
+
+XSpi_Config* XSpi_LookupConfig(const u16 DeviceId) {
+    return (DeviceId == config.DeviceId) ? &config : nullptr;
+}
+
+int XSpi_CfgInitialize(XSpi* InstancePtr,
+                       [[maybe_unused]] XSpi_Config* Config,
+                       const UINTPTR EffectiveAddr) {
+    *InstancePtr = XSpi{};
+    InstancePtr->BaseAddr = EffectiveAddr;
+    InstancePtr->IsReady = XIL_COMPONENT_IS_READY;
+    return XST_SUCCESS;
+}
+
+int XSpi_SetOptions(XSpi* InstancePtr, const u32 Options) {
+    InstancePtr->Options = Options;
+    return XST_SUCCESS;
+}
+
+int XSpi_Start(XSpi* InstancePtr) {
+    InstancePtr->IsStarted = XIL_COMPONENT_IS_READY;
+    return XST_SUCCESS;
+}
+
+int XSpi_SetSlaveSelect(XSpi* InstancePtr, const u32 SlaveMask) {
+    InstancePtr->SlaveSelectReg = SlaveMask;
+    return XST_SUCCESS;
+}
+
+int XSpi_Transfer(XSpi* InstancePtr,
+                  u8* SendBufPtr,
+                  u8* RecvBufPtr,
+                  const unsigned int ByteCount) {
+    if(InstancePtr->IsStarted != XIL_COMPONENT_IS_READY || InstancePtr->SlaveSelectReg == 0
+       || ByteCount == 0) {
+        return XST_FAILURE;
+    }
+
+    wiper_code.store(SendBufPtr[ByteCount - 1], std::memory_order_relaxed);
+    transfer_count.fetch_add(1, std::memory_order_relaxed);
+
+    if(RecvBufPtr != nullptr) {
+        for(unsigned int i = 0; i < ByteCount; i++) {
+            RecvBufPtr[i] = 0;
+        }
+    }
+    return XST_SUCCESS;
+}
+
+/*------------------------------------------------------------------------------------------------*/
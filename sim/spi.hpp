@@ -0,0 +1,23 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    spi.hpp
+/// @brief   Simulated digital potentiometer on the thermistor SPI bus.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cstdint>
+
+/*------------------------------------------------------------------------------------------------*/
+// host side
+/*------------------------------------------------------------------------------------------------*/
+
+namespace sim::spi {
+
+auto wiper() -> uint8_t;
+
+auto transfers() -> uint32_t;
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,185 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    test_commands.cpp
+/// @brief   Commands and their replies, on the simulated analyser.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <span>
+#include <variant>
+
+#include "xparameters.h"
+
+#include "gpio.hpp"
+#include "host.hpp"
+#include "interrupt.hpp"
+#include "sampler.hpp"
+#include "spi.hpp"
+
+using namespace sim;
+using namespace std::chrono_literals;
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace {
+
+constexpr uint16_t PAPER = XPAR_AXI_GPIO_PAPER_SENSOR_CONTROL_DEVICE_ID;
+constexpr uint16_t PLATEN = XPAR_AXI_GPIO_PLATEN_SENSOR_CONTROL_DEVICE_ID;
+
+constexpr uint8_t ACK = 0x06;
+
+/// @brief Commands are handled in order, so once a poll is answered everything before it has been.
+auto sync() -> void {
+    host::send('P');
+    host::expect_frame(ACK);
+}
+
+auto boots_at_25c() -> void {
+    // 25C sits at mid scale with the default thermistor and potentiometer.
+    host::check(spi::transfers() == 1, "temperature set once at start up");
+    host::check(spi::wiper() == 127, "25C wiper code");
+}
+
+auto poll() -> void {
+    host::send('P');
+    const auto ack = host::expect_frame(ACK);
+    host::check(ack.payload.empty(), "acknowledge has no payload");
+}
+
+auto sensors() -> void {
+    host::send('A');
+    host::send('L');
+    sync();
+    host::check(gpio::output(PAPER, 1) == 1, "paper in");
+    host::check(gpio::output(PLATEN, 1) == 1, "platen in");
+
+    host::send('a');
+    host::send('l');
+    sync();
+    host::check(gpio::output(PAPER, 1) == 0, "paper out");
+    host::check(gpio::output(PLATEN, 1) == 0, "platen out");
+}
+
+auto set_sensors() -> void {
+    const auto paper_writes = gpio::writes(PAPER, 1);
+    const auto platen_writes = gpio::writes(PLATEN, 1);
+
+    host::send('M', 0b11, 1);
+    const auto reply = host::expect_frame('M');
+
+    // The sim has a timer, so the latency follows the sensors.
+    host::check(reply.payload.size() == 5, "sensor state carries latency");
+    host::check(reply.payload[0] == 0b11, "sensor state echoes the mask");
+    host::check(gpio::output(PAPER, 1) == 1 && gpio::output(PLATEN, 1) == 1, "both sensors in");
+    host::check(gpio::writes(PAPER, 1) == paper_writes + 1, "paper written once");
+    host::check(gpio::writes(PLATEN, 1) == platen_writes + 1, "platen written once");
+
+    host::send('M', 0b00, 1);
+    host::check(host::expect_frame('M').payload[0] == 0, "sensors out");
+    host::check(gpio::output(PAPER, 1) == 0 && gpio::output(PLATEN, 1) == 0, "both sensors out");
+}
+
+auto errors() -> void {
+    host::send('Y');
+    host::expect_text("Unrecognised command");
+
+    // A start byte part way through a frame abandons it.
+    constexpr std::array<uint8_t, 3> broken{0x02, 'P', 0x02};
+    host::send_raw(broken);
+    host::expect_text("Frame error");
+
+    // Arguments that don't fit their command.
+    host::send('G');
+    host::expect_text("Unrecognised command");
+    host::send('X', 0x00700000, 4);
+    host::expect_text("Script rule rejected");
+
+    poll();
+}
+
+/// @brief Reports that are compiled out say so rather than going quiet.
+auto optional_reports() -> void {
+    host::send('I');
+    if(interrupt::PROFILING) {
+        // A frame per interrupt that's run, the UART's at least, then the poll's ACK.
+        host::send('P');
+        uint32_t profiles = 0;
+        while(true) {
+            const auto output = host::next();
+            const auto* const frame = output ? std::get_if<host::Frame>(&output.value()) : nullptr;
+            host::check(frame != nullptr, "profile frames");
+            if(frame->opcode == ACK) {
+                break;
+            }
+            host::check(frame->opcode == 'I', "profile frame");
+            profiles++;
+        }
+        host::check(profiles != 0, "some interrupt profiled");
+    } else {
+        host::expect_text("Interrupt profiling not built in");
+    }
+
+    // PC sampling is tested with its own build, in test_sampler.
+    if(!sampler::AVAILABLE) {
+        host::send('H');
+        host::expect_text("PC sampling not built in");
+    }
+}
+
+auto statistics() -> void {
+    // In protocol::send_statistics() order, each a high water mark and a count of drops.
+    host::send('S');
+    const auto stats = host::expect_frame('S');
+    host::check(stats.payload.size() == 6 * 8, "six queues");
+
+    host::send('K');
+    for(uint8_t task = 0; task < 4; task++) {
+        const auto frame = host::expect_frame('K');
+        host::check(frame.payload.size() == 1 + 4 + 4 + 8 + 4, "task stats with times");
+        host::check(frame.payload[0] == task, "tasks in order");
+        host::check(host::read_le(std::span(frame.payload).subspan(1), 4) != 0, "task has run");
+    }
+}
+
+auto cobs() -> void {
+    host::send('O');
+    host::set_cobs(true);
+    poll();
+
+    // Arguments holding zeros are what COBS is for.
+    host::send('M', 0b01, 4);
+    const auto reply = host::expect_frame('M');
+    host::check(reply.payload[0] == 0b01, "COBS sensor state");
+    host::check(gpio::output(PAPER, 1) == 1 && gpio::output(PLATEN, 1) == 0, "paper only");
+
+    host::send('o');
+    host::set_cobs(false);
+    poll();
+}
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto main() -> int {
+    host::boot();
+
+    boots_at_25c();
+    poll();
+    sensors();
+    set_sensors();
+    errors();
+    optional_reports();
+    statistics();
+    cobs();
+
+    host::expect_quiet(100ms);
+    std::puts("test_commands passed");
+    host::exit(0);
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,323 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    test_coroutine.cpp
+/// @brief   The coroutine executor and frame arena on their own, what a task switch costs, and the
+///          stream task as a coroutine against the state machine it replaced. Costs are for the
+///          host's CPU and only printed, to compare changes against.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <optional>
+
+#include "coroutine.hpp"
+#include "mech.hpp"
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace {
+
+constexpr uint32_t SWITCHES = 4'000'000;
+
+// Events streamed each way, and the resumes the stream task is given each time it runs.
+constexpr uint32_t EVENTS = 2'000'000;
+constexpr uint32_t STREAM_BUDGET = 32;
+
+constinit std::array<uint32_t, coroutine::TASKS_MAX> counts{};
+constinit bool go{false};
+
+// Spawned tasks stay with the executor for good, so they're replaced rather than let go out of
+// scope, as the stream task is.
+constinit std::array<coroutine::Task, coroutine::TASKS_MAX> spawned{};
+
+auto check(const bool condition, const char* const what) -> void {
+    if(!condition) {
+        std::fprintf(stderr, "check failed: %s\n", what);
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+/// @brief Count a resume then yield, forever.
+auto spinner(const uint32_t id) -> coroutine::Task {
+    while(true) {
+        counts[id]++;
+        co_await coroutine::yield();
+    }
+}
+
+/// @brief Count a resume each time go is set, then wait for it again.
+auto waiter(const uint32_t id) -> coroutine::Task {
+    while(true) {
+        co_await coroutine::until([] { return go; });
+        counts[id]++;
+        co_await coroutine::yield();
+    }
+}
+
+/// @brief Like the stream task, holds state across an await so it's kept in the frame.
+auto holder(const uint32_t id) -> coroutine::Task {
+    std::array<uint32_t, 16> held{};
+    while(true) {
+        const auto value = co_await coroutine::until([id] { return go ? id + 1 : 0U; });
+        held[value % held.size()] += value;
+        counts[id] += held[value % held.size()];
+        co_await coroutine::yield();
+    }
+}
+
+template<typename Duration>
+auto ns_each(const Duration elapsed, const uint64_t count) -> double {
+    return std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(count);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Frames come from a fixed number of slots and are given back when a task goes.
+auto arena() -> void {
+    std::array<coroutine::Task, coroutine::FRAME_SLOTS> tasks{};
+    for(uint32_t i = 0; i < tasks.size(); i++) {
+        tasks[i] = holder(i);
+        check(tasks[i].valid(), "frame allocated");
+    }
+
+    auto extra = holder(0);
+    check(!extra.valid(), "no slot left");
+
+    tasks[0].reset();
+    extra = holder(0);
+    check(extra.valid(), "slot given back");
+
+    std::printf("largest frame %zu of %u bytes\n",
+                coroutine::largest_frame(),
+                coroutine::FRAME_SLOT_SIZE);
+    check(coroutine::largest_frame() <= coroutine::FRAME_SLOT_SIZE, "frames fit their slots");
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Every ready task gets a turn, no more than budget resumes are made, and tasks waiting on
+///        a condition are passed over until it's met. Then the cost of a switch.
+auto executor() -> void {
+    spawned[0] = spinner(0);
+    spawned[1] = spinner(1);
+    spawned[2] = waiter(2);
+    spawned[3] = holder(3);
+    for(auto& task : spawned) {
+        check(coroutine::spawn(task), "task spawned");
+    }
+    check(coroutine::spawn(spawned[0]), "spawning twice is harmless");
+
+    coroutine::Task extra{};
+    check(!coroutine::spawn(extra), "executor full");
+
+    // The spinners never stop being ready so the budget is always what ends a run.
+    check(coroutine::run(3), "budget ran out");
+    check(counts[0] == 1 && counts[1] == 1, "spinners resumed in turn");
+    check(counts[2] == 0 && counts[3] == 0, "waiters still waiting");
+
+    go = true;
+    coroutine::run(4);
+    check(counts[2] == 1, "waiter resumed once its condition was met");
+    check(counts[3] == 4, "holder resumed with its condition's result");
+    go = false;
+
+    // Two tasks switching between themselves, two polled and skipped each turn. The waiters take
+    // a resume each to get back to waiting first.
+    counts = {};
+    auto start = std::chrono::steady_clock::now();
+    coroutine::run(SWITCHES);
+    const auto yield_ns = ns_each(std::chrono::steady_clock::now() - start, SWITCHES);
+    check(counts[0] + counts[1] == SWITCHES - 2, "every resume counted");
+    check(counts[2] == 0 && counts[3] == 0, "waiters went back to waiting");
+
+    // All four switching, half through an until() whose condition is polled on the way.
+    go = true;
+    counts = {};
+    start = std::chrono::steady_clock::now();
+    coroutine::run(SWITCHES);
+    const auto mixed_ns = ns_each(std::chrono::steady_clock::now() - start, SWITCHES);
+    go = false;
+
+    std::printf("per resume: %.1f ns with 2 of 4 tasks ready, %.1f ns with all 4\n",
+                yield_ns,
+                mixed_ns);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Stand-ins for the mech buffers and the link, shared by both ways of streaming. Events
+///        repeat a print's pattern and each burn line turns up a poll after its stop event.
+namespace source {
+
+constexpr std::array PATTERN{
+    mech::Action::Advance,
+    mech::Action::BurnLineStart,
+    mech::Action::BurnLineStop,
+    mech::Action::Advance,
+    mech::Action::Reverse,
+    mech::Action::BurnLineStart,
+    mech::Action::BurnLineStop,
+};
+
+constinit uint32_t next{0};
+constinit bool line_ready{false};
+constinit mech::BurnLine line{};
+
+constinit uint32_t events_sent{0};
+constinit uint32_t lines_sent{0};
+
+auto reset() -> void {
+    next = 0;
+    line_ready = false;
+    events_sent = 0;
+    lines_sent = 0;
+}
+
+auto get_next_event() -> std::optional<mech::Event> {
+    if(next == EVENTS) {
+        return std::nullopt;
+    }
+    const auto event = mech::Event{.action = PATTERN[next % PATTERN.size()], .time = next};
+    next++;
+    return event;
+}
+
+auto read_burn_line() -> const mech::BurnLine* {
+    line_ready = !line_ready;
+    return line_ready ? nullptr : &line;
+}
+
+constinit bool credit_enabled{false};
+constinit uint32_t credit{0};
+
+auto has_credit(const uint32_t frames) -> bool {
+    return !credit_enabled || credit >= frames;
+}
+
+auto frames_for([[maybe_unused]] const mech::Event event) -> uint32_t {
+    return 1;
+}
+
+auto send_event([[maybe_unused]] const mech::Event event) -> void {
+    events_sent++;
+}
+
+auto send_burn_line([[maybe_unused]] const mech::BurnLine& burn_line) -> void {
+    lines_sent++;
+}
+
+}
+
+/// @brief stream::process() as of 9ca0cfe, with the event held between calls and an early
+///        return wherever it's held up, for a baseline. Lines are released as soon as they're sent
+///        so the line slots never fill.
+namespace baseline {
+
+constinit std::optional<mech::Event> event_next{};
+
+[[gnu::noinline]] auto process() -> bool {
+    if(!event_next) {
+        event_next = source::get_next_event();
+    }
+
+    if(!event_next) {
+        return false;
+    }
+
+    if(!source::has_credit(source::frames_for(event_next.value()))) {
+        return false;
+    }
+
+    if(event_next->action == mech::Action::BurnLineStop) {
+        const auto* const burn_line = source::read_burn_line();
+        if(burn_line == nullptr) {
+            return false;
+        }
+
+        source::send_event(event_next.value());
+        source::send_burn_line(*burn_line);
+    } else {
+        source::send_event(event_next.value());
+    }
+
+    event_next.reset();
+    return true;
+}
+
+}
+
+/// @brief stream.cpp's send_events() against the same stand-ins.
+auto send_events() -> coroutine::Task {
+    while(true) {
+        const auto event = co_await coroutine::until(source::get_next_event);
+
+        co_await coroutine::until([&event] {
+            return source::has_credit(source::frames_for(event.value()));
+        });
+
+        if(event->action == mech::Action::BurnLineStop) {
+            const auto* const burn_line = co_await coroutine::until(source::read_burn_line);
+
+            source::send_event(event.value());
+            source::send_burn_line(*burn_line);
+        } else {
+            source::send_event(event.value());
+        }
+
+        co_await coroutine::yield();
+    }
+}
+
+/// @brief The same events sent by each, driven as the stream task drives them, and what each costs
+///        per event.
+auto streaming() -> void {
+    source::reset();
+    auto start = std::chrono::steady_clock::now();
+    while(source::next != EVENTS || baseline::event_next) {
+        for(uint32_t i = 0; i < STREAM_BUDGET; i++) {
+            if(!baseline::process()) {
+                break;
+            }
+        }
+    }
+    const auto machine_ns = ns_each(std::chrono::steady_clock::now() - start, EVENTS);
+    check(source::events_sent == EVENTS, "state machine sent every event");
+    const auto machine_lines = source::lines_sent;
+
+    source::reset();
+    for(auto& task : spawned) {
+        task.reset();
+    }
+    spawned[0] = send_events();
+    check(spawned[0].valid(), "stream task started");
+    start = std::chrono::steady_clock::now();
+    while(source::events_sent != EVENTS) {
+        coroutine::run(STREAM_BUDGET);
+    }
+    const auto coroutine_ns = ns_each(std::chrono::steady_clock::now() - start, EVENTS);
+    check(source::lines_sent == machine_lines, "coroutine sent every line");
+
+    std::printf("per event: %.1f ns as a state machine, %.1f ns as a coroutine (%.2fx)\n",
+                machine_ns,
+                coroutine_ns,
+                coroutine_ns / machine_ns);
+}
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto main() -> int {
+    arena();
+    executor();
+    streaming();
+
+    std::puts("test_coroutine passed");
+    return EXIT_SUCCESS;
+}
+
+/*------------------------------------------------------------------------------------------------*/
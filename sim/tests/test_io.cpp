@@ -0,0 +1,116 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    test_io.cpp
+/// @brief   A script rule firing from the motor ISR while the main loop has a batch of sensor
+///          changes open, as it does handling 'M'. The sim runs a test entry rather than the
+///          firmware's main() so the batch can be held open until the rule has fired.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+
+#include "xparameters.h"
+
+#include "cpu.hpp"
+#include "gpio.hpp"
+#include "host.hpp"
+#include "interrupt.hpp"
+#include "io.hpp"
+#include "mech.hpp"
+#include "print_mech.hpp"
+#include "script.hpp"
+#include "timer.hpp"
+
+using namespace sim;
+using namespace std::chrono_literals;
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace {
+
+constexpr uint16_t PAPER = XPAR_AXI_GPIO_PAPER_SENSOR_CONTROL_DEVICE_ID;
+constexpr uint16_t PLATEN = XPAR_AXI_GPIO_PLATEN_SENSOR_CONTROL_DEVICE_ID;
+
+enum class Phase : uint8_t {
+    Starting,
+    BatchOpen,
+    RuleFired,
+    BatchClosed,
+};
+
+constinit std::atomic<Phase> phase{Phase::Starting};
+
+template<typename Condition>
+auto wait_until(const Condition condition, const char* const what) -> void {
+    const auto deadline = std::chrono::steady_clock::now() + host::TIMEOUT;
+    while(!condition()) {
+        host::check(std::chrono::steady_clock::now() < deadline, what);
+        std::this_thread::sleep_for(100us);
+    }
+}
+
+/// @brief The M handler's batch, held open by the firmware's thread while the harness steps the
+///        motor with interrupts enabled.
+auto entry() -> int {
+    io::init();
+    io::paper_out();
+    io::platen_out();
+
+    timer::init();
+    interrupt::init();
+    mech::init();
+
+    script::add({.trigger = script::Trigger::Steps,
+                 .action = script::Action::PlatenIn,
+                 .value = 0,
+                 .count = 1});
+    script::start();
+
+    {
+        const io::Batch batch{};
+        io::paper_in();
+        io::platen_out();
+
+        phase.store(Phase::BatchOpen);
+        while(phase.load() != Phase::RuleFired) {}
+    }
+    phase.store(Phase::BatchClosed);
+
+    while(true) {}
+}
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto main() -> int {
+    cpu::boot(entry);
+    wait_until([] { return phase.load() == Phase::BatchOpen; }, "batch opened");
+
+    const auto paper_writes = gpio::writes(PAPER, 1);
+    host::check(gpio::output(PAPER, 1) == 0, "batched paper held back");
+
+    const print_mech::Script script{print_mech::advance(20'000)};
+    print_mech::run(script);
+    wait_until([] { return print_mech::done() && gpio::output(PLATEN, 1) == 1; }, "rule fired");
+
+    // The rule's pin went straight out but nothing the batch holds went with it.
+    host::check(gpio::output(PAPER, 1) == 0, "batched paper still held back after the ISR");
+    host::check(gpio::writes(PAPER, 1) == paper_writes, "ISR didn't write the paper sensor");
+
+    phase.store(Phase::RuleFired);
+    wait_until([] { return phase.load() == Phase::BatchClosed; }, "batch closed");
+
+    host::check(gpio::output(PAPER, 1) == 1, "paper in once the batch closed");
+    host::check(gpio::writes(PAPER, 1) == paper_writes + 1, "paper written once");
+    host::check(gpio::output(PLATEN, 1) == 1, "rule's platen in kept");
+
+    std::puts("test_io passed");
+    host::exit(0);
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,232 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    test_ring_buffer.cpp
+/// @brief   RingBuffer stress test with an ISR for a producer. The ISR is a SIGALRM handler on the
+///          same thread as the consumer, the only arrangement the buffer is made for.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <span>
+
+#include <signal.h>
+#include <sys/time.h>
+
+#include "ring_buffer.hpp"
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace {
+
+constexpr uint32_t CAPACITY = 16;
+
+// Enough to wrap the indexes of a small buffer many times over.
+constexpr uint32_t TARGET = 100'000;
+
+constexpr suseconds_t TICK_US = 20;
+
+// Pushes per tick cycle through 1 to BURST_MAX so single and bulk pushes both wrap.
+constexpr uint32_t BURST_MAX = 5;
+
+/// @brief A queue under test and what the ISR has done to it.
+template<Overflow POLICY>
+struct Subject {
+    RingBuffer<uint32_t, CAPACITY, POLICY> buffer{};
+
+    // Written only by the ISR.
+    volatile uint32_t produced{0};
+    volatile uint32_t refused{0};
+    volatile uint32_t ticks{0};
+    volatile bool bulk{false};
+};
+
+// A fresh subject for each run.
+std::array<Subject<Overflow::DropNewest>, 3> newest{};
+Subject<Overflow::DropOldest> oldest{};
+
+// Which subject the ISR is producing for. 0 for none, 1 to 3 for a newest run, 4 for oldest.
+constinit volatile sig_atomic_t producing{0};
+
+auto check(const bool condition, const char* const what) -> void {
+    if(!condition) {
+        std::fprintf(stderr, "check failed: %s\n", what);
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Push the next burst of sequence numbers, all at once or one at a time.
+template<Overflow POLICY>
+auto produce(Subject<POLICY>& subject) -> void {
+    const uint32_t count = (subject.ticks % BURST_MAX) + 1;
+    subject.ticks = subject.ticks + 1;
+
+    std::array<uint32_t, BURST_MAX> burst{};
+    for(uint32_t i = 0; i < count; i++) {
+        burst[i] = subject.produced + i;
+    }
+
+    uint32_t accepted = 0;
+    if(subject.bulk) {
+        accepted = subject.buffer.push(std::span<const uint32_t>(burst).first(count));
+    } else {
+        for(uint32_t i = 0; i < count; i++) {
+            accepted += subject.buffer.push(burst[i]) ? 1U : 0U;
+        }
+    }
+
+    subject.refused = subject.refused + (count - accepted);
+    subject.produced = subject.produced + count;
+}
+
+auto isr(int /*signal*/) -> void {
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    if(producing == 4) {
+        produce(oldest);
+    } else if(producing != 0) {
+        produce(newest[static_cast<uint32_t>(producing - 1)]);
+    }
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+}
+
+auto start_ticks() -> void {
+    struct sigaction action{};
+    action.sa_handler = isr;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    check(sigaction(SIGALRM, &action, nullptr) == 0, "SIGALRM handler installed");
+
+    const itimerval timer{.it_interval = {.tv_sec = 0, .tv_usec = TICK_US},
+                          .it_value = {.tv_sec = 0, .tv_usec = TICK_US}};
+    check(setitimer(ITIMER_REAL, &timer, nullptr) == 0, "interval timer started");
+}
+
+auto stop_ticks() -> void {
+    const itimerval timer{};
+    setitimer(ITIMER_REAL, &timer, nullptr);
+}
+
+/// @brief Keep the consumer away for a while, long enough sometimes for the buffer to fill.
+auto stall(const uint32_t round) -> void {
+    const uint32_t spins = (round % 256 == 0) ? 50'000 : 100;
+    for(volatile uint32_t i = 0; i < spins; i = i + 1) {}
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief DropNewest loses whatever didn't fit, so sequence numbers only ever increase and every
+///        gap is the ISR's refused pushes, exactly as counted by the buffer.
+auto drop_newest(const uint32_t run, const bool bulk, const bool in_place) -> void {
+    auto& subject = newest[run];
+    subject.bulk = bulk;
+
+    uint32_t next = 0;
+    uint32_t received = 0;
+    uint32_t skipped = 0;
+    const auto take = [&](const uint32_t value) {
+        check(value >= next, "sequence never goes backwards");
+        skipped += value - next;
+        next = value + 1;
+        received++;
+    };
+
+    start_ticks();
+    producing = static_cast<sig_atomic_t>(run + 1);
+    for(uint32_t round = 0; subject.produced < TARGET; round++) {
+        if(in_place) {
+            const auto available = subject.buffer.read_span();
+            for(const auto value : available) {
+                take(value);
+            }
+            subject.buffer.consume(static_cast<uint32_t>(available.size()));
+        } else {
+            std::array<uint32_t, 4> values{};
+            const auto count = subject.buffer.pop(values);
+            std::for_each_n(values.begin(), count, take);
+        }
+        stall(round);
+    }
+    producing = 0;
+    stop_ticks();
+
+    while(const auto value = subject.buffer.pop()) {
+        take(value.value());
+    }
+    skipped += subject.produced - next;
+
+    const auto stats = subject.buffer.stats();
+    check(received + skipped == subject.produced, "every value received or skipped");
+    check(skipped == subject.refused, "gaps are the refused pushes");
+    check(stats.dropped == subject.refused, "buffer counts the refused pushes");
+    check(stats.high_water == CAPACITY, "buffer filled");
+    check(subject.refused != 0, "buffer overflowed");
+    check(subject.buffer.pushed() == received, "pushed count");
+
+    std::printf("drop newest %s %s: %u produced, %u dropped\n",
+                bulk ? "bulk" : "single",
+                in_place ? "in place" : "copied",
+                subject.produced,
+                stats.dropped);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief DropOldest loses the oldest elements instead, which the consumer counts as it skips
+///        past them. A value is never returned torn or twice.
+auto drop_oldest() -> void {
+    auto& subject = oldest;
+
+    uint32_t next = 0;
+    uint32_t received = 0;
+    const auto take = [&](const uint32_t value) {
+        check(value >= next, "sequence never goes backwards");
+        check(value < subject.produced, "value was produced");
+        next = value + 1;
+        received++;
+    };
+
+    start_ticks();
+    producing = 4;
+    for(uint32_t round = 0; subject.produced < TARGET; round++) {
+        if(const auto value = subject.buffer.pop()) {
+            take(value.value());
+        }
+        stall(round);
+    }
+    producing = 0;
+    stop_ticks();
+
+    while(const auto value = subject.buffer.pop()) {
+        take(value.value());
+    }
+
+    const auto stats = subject.buffer.stats();
+    check(subject.refused == 0, "DropOldest always accepts");
+    check(next == subject.produced, "newest value received");
+    check(received + stats.dropped == subject.produced, "every value received or dropped");
+    check(stats.dropped != 0, "buffer overflowed");
+
+    std::printf("drop oldest: %u produced, %u dropped\n", subject.produced, stats.dropped);
+}
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto main() -> int {
+    drop_newest(0, false, false);
+    drop_newest(1, true, false);
+    drop_newest(2, true, true);
+    drop_oldest();
+
+    std::puts("test_ring_buffer passed");
+    return EXIT_SUCCESS;
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,138 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    test_sampler.cpp
+/// @brief   The PC sample histogram, on the simulated analyser built with PC sampling. The
+///          simulator's timer interrupts on its own input and the PC sampled is wherever the
+///          firmware's thread was when it was taken.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "host.hpp"
+#include "sampler.hpp"
+#include "tmrctr.hpp"
+
+using namespace sim;
+using namespace std::chrono_literals;
+
+// Bounds of .text, defined for the host by the simulator's link arguments.
+extern "C" const uint8_t __text_start[];
+extern "C" const uint8_t __text_end[];
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace {
+
+constexpr uint8_t ACK = 0x06;
+
+struct Histogram {
+    uint32_t low_pc;
+    uint32_t bucket_size;
+    std::vector<uint16_t> buckets;
+};
+
+/// @brief Ask for the histogram and put its frames back together.
+auto request_histogram() -> Histogram {
+    host::send('H');
+
+    Histogram histogram{};
+    uint32_t total = sampler::BUCKETS;
+    while(histogram.buckets.size() < total) {
+        const auto frame = host::expect_frame('H');
+        const auto payload = std::span(frame.payload);
+        host::check(payload.size() >= 12, "histogram header");
+
+        const auto low_pc = static_cast<uint32_t>(host::read_le(payload.subspan(0), 4));
+        const auto bucket_size = static_cast<uint32_t>(host::read_le(payload.subspan(4), 4));
+        total = static_cast<uint32_t>(host::read_le(payload.subspan(8), 2));
+        const auto first = host::read_le(payload.subspan(10), 2);
+
+        if(histogram.buckets.empty()) {
+            histogram.low_pc = low_pc;
+            histogram.bucket_size = bucket_size;
+        }
+        host::check(low_pc == histogram.low_pc && bucket_size == histogram.bucket_size,
+                    "every frame describes the same histogram");
+        host::check(first == histogram.buckets.size(), "frames in order");
+
+        const auto counts = payload.subspan(12);
+        host::check(!counts.empty() && counts.size() % 2 == 0, "whole bucket counts");
+        for(size_t i = 0; i < counts.size(); i += 2) {
+            histogram.buckets.push_back(static_cast<uint16_t>(host::read_le(counts.subspan(i), 2)));
+        }
+    }
+
+    host::check(histogram.buckets.size() == total, "no more buckets than the header says");
+    return histogram;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Buckets cover .text in whole instructions and the idle firmware lands in some of them.
+auto samples() -> void {
+    std::this_thread::sleep_for(300ms);
+    host::check(tmrctr::interrupts() != 0, "timer interrupted");
+
+    const auto histogram = request_histogram();
+    host::check(histogram.buckets.size() == sampler::BUCKETS, "every bucket sent");
+
+    const auto text_start = reinterpret_cast<uintptr_t>(__text_start);
+    const auto text_size = static_cast<uint64_t>(__text_end - __text_start);
+    host::check(histogram.low_pc == static_cast<uint32_t>(text_start), "starts at .text");
+    host::check(histogram.bucket_size != 0 && histogram.bucket_size % 4 == 0,
+                "whole instructions per bucket");
+    host::check(static_cast<uint64_t>(histogram.bucket_size) * sampler::BUCKETS >= text_size,
+                "buckets cover .text");
+
+    uint64_t total = 0;
+    for(size_t bucket = 0; bucket < histogram.buckets.size(); bucket++) {
+        const auto count = histogram.buckets[bucket];
+        host::check(count == 0 || bucket * histogram.bucket_size < text_size,
+                    "no samples past the end of .text");
+        total += count;
+    }
+    std::printf("%llu samples from %u timer interrupts\n",
+                static_cast<unsigned long long>(total),
+                tmrctr::interrupts());
+    host::check(total != 0, "some samples");
+}
+
+/// @brief Sending the histogram clears it.
+auto cleared() -> void {
+    const auto before = tmrctr::interrupts();
+    const auto histogram = request_histogram();
+
+    uint64_t total = 0;
+    for(const auto count : histogram.buckets) {
+        total += count;
+    }
+    // One interrupt may have been raised before the count was read and taken after the clear.
+    host::check(total <= tmrctr::interrupts() - before + 1, "only samples since the last request");
+
+    host::send('P');
+    host::expect_frame(ACK);
+}
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto main() -> int {
+    host::boot();
+    host::check(sampler::AVAILABLE, "built with PC sampling");
+
+    samples();
+    cleared();
+
+    host::expect_quiet(100ms);
+    std::puts("test_sampler passed");
+    host::exit(0);
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,492 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    test_stream.cpp
+/// @brief   Recorded print mech activity as it reaches the host, on the simulated analyser.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <optional>
+#include <thread>
+#include <variant>
+#include <vector>
+
+#include "xparameters.h"
+
+#include "coroutine.hpp"
+#include "gpio.hpp"
+#include "host.hpp"
+#include "llfifo.hpp"
+#include "print_mech.hpp"
+#include "spi.hpp"
+
+using namespace sim;
+using namespace std::chrono_literals;
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace {
+
+constexpr uint16_t PAPER = XPAR_AXI_GPIO_PAPER_SENSOR_CONTROL_DEVICE_ID;
+
+constexpr uint8_t ACK = 0x06;
+
+constexpr uint32_t STEP = 20'000;
+constexpr uint32_t BURN = 50'000;
+
+auto sync() -> void {
+    host::send('P');
+    host::expect_frame(ACK);
+}
+
+/// @brief Start a fresh recording. Everything sent before is read and thrown away.
+auto record() -> void {
+    host::send('R');
+    sync();
+}
+
+auto play(const print_mech::Script& script) -> void {
+    print_mech::run(script);
+    while(!print_mech::done()) {
+        std::this_thread::sleep_for(100us);
+    }
+}
+
+auto pattern(const uint8_t seed) -> host::Line {
+    host::Line line{};
+    for(uint32_t i = 0; i < line.size(); i++) {
+        line[i] = static_cast<uint8_t>((i * 7) + seed);
+    }
+    return line;
+}
+
+/// @brief A line that's mostly blank with a few dots. Holds every byte the escaped framing has to
+///        escape, so it can't be sent straight from its slot.
+auto sparse(const uint8_t seed) -> host::Line {
+    host::Line line{};
+    line[1] = 0x02;
+    line[2] = 0x03;
+    line[3] = 0x1B;
+    line[10 + (seed % 30)] = 0xFF;
+    return line;
+}
+
+auto expect_line(host::LineDecoder& decoder, const uint8_t opcode, const host::Line& expected)
+    -> void {
+    host::check(decoder.decode(host::expect_frame(opcode)) == expected, "line decodes");
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto raw_lines() -> void {
+    record();
+    host::LineDecoder decoder{};
+
+    const auto first = pattern(1);
+    const auto second = sparse(2);
+    play({
+        print_mech::advance(STEP),
+        print_mech::advance(STEP),
+        print_mech::line(first, STEP, BURN),
+        print_mech::reverse(STEP),
+        print_mech::line(second, STEP, BURN),
+    });
+
+    host::expect_frame('F');
+    host::expect_frame('F');
+    expect_line(decoder, 'U', first);
+    host::expect_frame('B');
+    expect_line(decoder, 'U', second);
+}
+
+auto compressed_lines() -> void {
+    host::send('C');
+    record();
+    host::LineDecoder decoder{};
+
+    const std::array lines{pattern(1), pattern(1), sparse(3), host::Line{}, pattern(9)};
+    print_mech::Script script{};
+    for(const auto& line : lines) {
+        script.push_back(print_mech::line(line, STEP, BURN));
+    }
+    play(script);
+
+    for(const auto& line : lines) {
+        expect_line(decoder, 'Z', line);
+    }
+    host::send('c');
+}
+
+/// @brief Raw lines, whether sent in place or copied, become the reference for the compressed
+///        lines after them.
+auto raw_then_compressed() -> void {
+    record();
+    host::LineDecoder decoder{};
+
+    const auto in_place = pattern(4);
+    const auto copied = sparse(5);
+    const auto after_in_place = pattern(6);
+    const auto after_copied = pattern(7);
+
+    play({print_mech::line(in_place, STEP, BURN)});
+    expect_line(decoder, 'U', in_place);
+    host::send('C');
+    play({print_mech::line(after_in_place, STEP, BURN)});
+    expect_line(decoder, 'Z', after_in_place);
+
+    host::send('c');
+    play({print_mech::line(copied, STEP, BURN)});
+    expect_line(decoder, 'U', copied);
+    host::send('C');
+    play({print_mech::line(after_copied, STEP, BURN)});
+    expect_line(decoder, 'Z', after_copied);
+
+    host::send('c');
+}
+
+/// @brief Read event blocks up to the next other frame, merging runs split across blocks.
+struct Runs {
+    std::vector<host::EventRun> runs;
+    uint32_t blocks;
+    host::Frame next;
+};
+
+auto read_runs() -> Runs {
+    Runs read{};
+    while(true) {
+        const auto output = host::next();
+        host::check(output && std::holds_alternative<host::Frame>(*output), "frame received");
+        const auto& frame = std::get<host::Frame>(*output);
+        if(frame.opcode != 'E') {
+            read.next = frame;
+            return read;
+        }
+        read.blocks++;
+        auto& runs = read.runs;
+        for(const auto run : host::decode_event_block(frame)) {
+            if(!runs.empty() && runs.back().code == run.code) {
+                runs.back().count = static_cast<uint8_t>(runs.back().count + run.count);
+            } else {
+                runs.push_back(run);
+            }
+        }
+    }
+}
+
+auto event_blocks() -> void {
+    host::send('E');
+    record();
+
+    // Faster than the link so events pile up while each block goes out.
+    constexpr uint32_t FAST = 500;
+    print_mech::Script script{};
+    for(uint32_t i = 0; i < 40; i++) {
+        script.push_back(print_mech::advance(FAST));
+    }
+    script.push_back(print_mech::reverse(FAST));
+    script.push_back(print_mech::reverse(FAST));
+    script.push_back(print_mech::advance(FAST));
+    script.push_back(print_mech::line(pattern(0), FAST, BURN));
+    play(script);
+
+    // Everything batched goes out ahead of the line.
+    const auto [runs, blocks, line] = read_runs();
+    host::check(line.opcode == 'U', "line after the events");
+    host::check(runs.size() == 3, "three runs");
+    host::check(runs[0].code == 'F' && runs[0].count == 40, "advances");
+    host::check(runs[1].code == 'B' && runs[1].count == 2, "reverses");
+    host::check(runs[2].code == 'F' && runs[2].count == 1, "advance");
+    host::check(blocks < 43, "events batched");
+
+    host::send('e');
+    sync();
+}
+
+auto reliable_lines() -> void {
+    host::send('Q');
+    record();
+    host::LineDecoder decoder{};
+
+    const std::array lines{pattern(2), sparse(4), pattern(8)};
+    std::vector<host::Frame> frames{};
+    for(const auto& line : lines) {
+        play({print_mech::line(line, STEP, BURN)});
+        frames.push_back(host::expect_frame('V'));
+        host::check(decoder.decode(frames.back()) == line, "reliable line decodes");
+        host::check(host::read_le(frames.back().payload, 2) == frames.size() - 1, "sequence");
+    }
+
+    // Lines still held come back as they were, ones never sent as just their number.
+    host::send('N', 0x030001, 3);
+    host::check(host::expect_frame('V').payload == frames[1].payload, "retransmit first");
+    host::check(host::expect_frame('V').payload == frames[2].payload, "retransmit second");
+    host::check(host::read_le(host::expect_frame('v').payload, 2) == 3, "not sent");
+
+    // A burst of requests for more than the transmit buffer holds goes out as room allows, every
+    // frame of it. The poll after it is only answered once the last is queued, though its ACK,
+    // being a control frame, can overtake the ones still waiting.
+    constexpr uint32_t BURST = 4;
+    for(uint32_t i = 0; i < BURST; i++) {
+        host::send('N', 0xFF0000, 3);
+    }
+    host::send('P');
+
+    uint32_t resent = 0;
+    bool acknowledged = false;
+    while(resent < BURST * 0xFF || !acknowledged) {
+        const auto output = host::next();
+        host::check(output && std::holds_alternative<host::Frame>(*output), "frame received");
+        const auto& frame = std::get<host::Frame>(*output);
+        if(frame.opcode == ACK) {
+            host::check(resent > (BURST - 1) * 0xFF, "poll answered after the burst");
+            acknowledged = true;
+            continue;
+        }
+
+        const auto sequence = resent++ % 0xFF;
+        host::check(frame.opcode == ((sequence < lines.size()) ? 'V' : 'v'), "held or not");
+        host::check(host::read_le(frame.payload, 2) == sequence, "burst in order");
+    }
+
+    host::send('q');
+}
+
+auto cobs_lines() -> void {
+    host::send('O');
+    host::set_cobs(true);
+    record();
+    host::LineDecoder decoder{};
+
+    // Blank lines are all zeros, the worst case for stuffing.
+    const std::array lines{host::Line{}, pattern(0), sparse(1)};
+    print_mech::Script script{};
+    for(const auto& line : lines) {
+        script.push_back(print_mech::line(line, STEP, BURN));
+    }
+    play(script);
+
+    for(const auto& line : lines) {
+        expect_line(decoder, 'U', line);
+    }
+
+    host::send('o');
+    host::set_cobs(false);
+    sync();
+}
+
+auto credit() -> void {
+    record();
+
+    host::send('G', 2, 1);
+    print_mech::Script script{};
+    for(uint32_t i = 0; i < 5; i++) {
+        script.push_back(print_mech::advance(STEP));
+    }
+    play(script);
+
+    host::expect_frame('F');
+    host::expect_frame('F');
+    host::expect_quiet(50ms);
+
+    host::send('G', 3, 1);
+    for(uint32_t i = 0; i < 3; i++) {
+        host::expect_frame('F');
+    }
+
+    host::send('g');
+    sync();
+}
+
+/// @brief Commands sent while lines are backed up in the transmit buffer are held until their
+///        replies fit, rather than stalling the stream or losing the replies.
+auto busy_replies() -> void {
+    constexpr uint32_t LINES = 24;
+
+    record();
+    host::LineDecoder decoder{};
+
+    // Lines that need escaping are copied into the transmit buffer, much faster than it drains.
+    print_mech::Script script{};
+    for(uint32_t i = 0; i < LINES; i++) {
+        script.push_back(print_mech::line(sparse(static_cast<uint8_t>(i)), STEP, BURN));
+    }
+    print_mech::run(script);
+    std::this_thread::sleep_for(20ms);
+
+    host::send('K');
+    host::send('S');
+    host::send('P');
+
+    uint32_t lines = 0;
+    uint32_t tasks = 0;
+    std::optional<host::Frame> stats{};
+    bool acknowledged = false;
+    while(lines < LINES || !acknowledged) {
+        const auto output = host::next();
+        host::check(output && std::holds_alternative<host::Frame>(*output), "frame received");
+        const auto& frame = std::get<host::Frame>(*output);
+        switch(frame.opcode) {
+            case 'U': {
+                host::check(decoder.decode(frame) == sparse(static_cast<uint8_t>(lines)),
+                            "lines in order");
+                lines++;
+                break;
+            }
+            case 'K': tasks++; break;
+            case 'S': {
+                host::check(tasks == 4, "replies in order");
+                stats = frame;
+                break;
+            }
+            case ACK: {
+                host::check(stats.has_value(), "acknowledged last");
+                acknowledged = true;
+                break;
+            }
+            default: host::check(false, "expected frame");
+        }
+    }
+
+    // High water mark then drops of the transmit buffer first and the control buffer last.
+    host::check(host::read_le(stats->payload, 4) > 512, "transmit buffer was backed up");
+    host::check(host::read_le(std::span(stats->payload).subspan(4), 4) == 0, "no bulk drops");
+    host::check(host::read_le(std::span(stats->payload).subspan(44), 4) == 0, "no control drops");
+}
+
+auto script_rules() -> void {
+    host::send('a');
+    host::send('x');
+
+    // Paper in on the second step, 40C after the first line.
+    constexpr uint32_t PAPER_IN = (2U << 0) | (1U << 20);
+    constexpr uint32_t HOT = (1U << 0) | (4U << 20) | (1U << 23) | (40U << 24);
+    host::send('X', PAPER_IN, 4);
+    host::send('X', HOT, 4);
+    record();
+
+    const auto transfers = spi::transfers();
+    play({print_mech::advance(STEP)});
+    host::expect_frame('F');
+    host::check(gpio::output(PAPER, 1) == 0, "paper still out after one step");
+
+    play({print_mech::advance(STEP), print_mech::line(pattern(3), STEP, BURN)});
+    host::expect_frame('F');
+    host::expect_frame('U');
+    sync();
+    host::check(gpio::output(PAPER, 1) == 1, "paper in after two steps");
+    host::check(spi::transfers() == transfers + 1, "temperature set once");
+    host::check(spi::wiper() < 127, "hotter than 25C");
+
+    host::send('x');
+    host::send('r');
+    sync();
+}
+
+/// @brief Read timestamped events until count have arrived, skipping the line frames between them.
+auto read_timed(host::TimeDecoder& decoder, const size_t count) -> std::vector<host::TimedEvent> {
+    std::vector<host::TimedEvent> events{};
+    while(events.size() < count) {
+        const auto output = host::next();
+        const auto* const frame = output ? std::get_if<host::Frame>(&output.value()) : nullptr;
+        host::check(frame != nullptr, "timestamped events arrive");
+        if(frame->opcode == 'T') {
+            const auto decoded = decoder.decode(*frame);
+            events.insert(events.end(), decoded.begin(), decoded.end());
+        }
+    }
+    host::check(events.size() == count, "no extra events");
+    return events;
+}
+
+/// @brief How far a decoded time is from when the sim did something, in cycles.
+auto offset(const uint64_t decoded, const uint64_t actual) -> int32_t {
+    return static_cast<int32_t>(static_cast<uint32_t>(decoded) - static_cast<uint32_t>(actual));
+}
+
+auto code(const print_mech::Signal signal) -> uint8_t {
+    switch(signal) {
+        case print_mech::Signal::Advance: return 'F';
+        case print_mech::Signal::Reverse: return 'B';
+        case print_mech::Signal::HeadOn: return 'H';
+        case print_mech::Signal::HeadOff: return 'h';
+    }
+    return '?';
+}
+
+/// @brief Absolute times rebuilt from 'T' frames match when each interrupt was raised, across
+///        frames and across recordings, which each start again from zero.
+auto timestamps() -> void {
+    // Time for the interrupt to be taken and its ISR to read the timer.
+    constexpr int32_t TOLERANCE = 2'000;
+
+    while(print_mech::raised()) {}
+
+    host::send('T');
+    host::TimeDecoder decoder{};
+
+    // More events than one frame holds.
+    constexpr uint32_t ADVANCES = 20;
+    for(const auto recording : {0, 1}) {
+        record();
+        decoder.reset();
+
+        print_mech::Script script{};
+        for(uint32_t i = 0; i < ADVANCES; i++) {
+            script.push_back(print_mech::advance(STEP));
+        }
+        script.push_back(print_mech::line(pattern(static_cast<uint8_t>(recording)), STEP, BURN));
+        script.push_back(print_mech::reverse(STEP));
+        play(script);
+
+        uint64_t previous = 0;
+        for(const auto& event : read_timed(decoder, ADVANCES + 3)) {
+            const auto raised = print_mech::raised();
+            host::check(raised.has_value() && event.code == code(raised->signal), "event order");
+            host::check(event.time > previous, "times increase");
+            host::check(std::abs(offset(event.time, raised->time)) < TOLERANCE,
+                        "absolute time matches the timer");
+            previous = event.time;
+        }
+    }
+
+    host::send('t');
+    host::send('r');
+    sync();
+}
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto main() -> int {
+    host::boot();
+
+    raw_lines();
+    compressed_lines();
+    raw_then_compressed();
+    event_blocks();
+    reliable_lines();
+    cobs_lines();
+    credit();
+    busy_replies();
+    script_rules();
+    timestamps();
+
+    host::check(llfifo::overflows() == 0, "burn buffer never overflowed");
+
+    // The firmware's stream task, started by every 'R' above.
+    std::printf("largest frame %zu of %u bytes\n",
+                coroutine::largest_frame(),
+                coroutine::FRAME_SLOT_SIZE);
+    host::check(coroutine::largest_frame() != 0, "stream task started");
+    host::check(coroutine::largest_frame() <= coroutine::FRAME_SLOT_SIZE, "frames fit their slots");
+    host::expect_quiet(100ms);
+    std::puts("test_stream passed");
+    host::exit(0);
+}
+
+/*------------------------------------------------------------------------------------------------*/
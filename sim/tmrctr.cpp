@@ -0,0 +1,129 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    tmrctr.cpp
+/// @brief   Simulated AXI Timer. Counter 0 counts the CPU's cycles, counter 1 generates periodic
+///          interrupts.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <atomic>
+#include <cstdint>
+
+#include "xparameters.h"
+
+#include "cpu.hpp"
+#include "intc.hpp"
+#include "tmrctr.hpp"
+
+/*------------------------------------------------------------------------------------------------*/
+// private variables
+/*------------------------------------------------------------------------------------------------*/
+
+namespace {
+
+constexpr uint8_t INPUT = XPAR_INTC_0_TMRCTR_0_VEC_ID;
+
+constexpr uint32_t TCR0_OFFSET = 0x08;
+constexpr uint32_t TCSR1_OFFSET = 0x10;
+constexpr uint32_t TLR1_OFFSET = 0x14;
+constexpr uint32_t TCR1_OFFSET = 0x18;
+
+constexpr uint32_t TCSR_ARHT = 0x010;
+constexpr uint32_t TCSR_LOAD = 0x020;
+constexpr uint32_t TCSR_ENIT = 0x040;
+constexpr uint32_t TCSR_ENT = 0x080;
+constexpr uint32_t TCSR_TINT = 0x100;
+
+constinit std::atomic<uint32_t> interrupt_count{0};
+
+// Only touched by the firmware's thread, inside a Critical or the tick handler. Counter 0 is free
+// running and ignores its control registers. Counter 1 is modelled by when it next expires, so
+// whether it counts up or down makes no difference.
+constinit uint32_t control{0};
+constinit uint32_t load{0};
+constinit uint64_t expires{0};
+
+auto period() -> uint64_t {
+    return static_cast<uint64_t>(load) + 1;
+}
+
+auto update_interrupt() -> void {
+    sim::intc::set_level(INPUT, (control & TCSR_TINT) != 0 && (control & TCSR_ENIT) != 0);
+}
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// host side
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Times counter 1 has expired with its interrupt enabled.
+auto sim::tmrctr::interrupts() -> uint32_t {
+    return interrupt_count.load(std::memory_order_relaxed);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// hardware side
+/*------------------------------------------------------------------------------------------------*/
+
+auto sim::tmrctr::read(const uint32_t offset) -> uint32_t {
+    const auto now = cpu::now();
+
+    switch(offset) {
+        case TCR0_OFFSET: return static_cast<uint32_t>(now);
+        case TCSR1_OFFSET: return control;
+        case TLR1_OFFSET: return load;
+        case TCR1_OFFSET: {
+            const auto remaining = (expires > now) ? expires - now : 0;
+            return ((control & TCSR_ENT) != 0) ? static_cast<uint32_t>(remaining) : load;
+        }
+        default: return 0;
+    }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Writing TINT set clears it. Setting ENT starts a period from now.
+auto sim::tmrctr::write(const uint32_t offset, const uint32_t value) -> void {
+    if(offset == TLR1_OFFSET) {
+        load = value;
+        return;
+    }
+
+    if(offset != TCSR1_OFFSET) {
+        return;
+    }
+
+    const bool starting = (control & TCSR_ENT) == 0 && (value & TCSR_ENT) != 0;
+    const auto interrupt = ((value & TCSR_TINT) != 0) ? 0U : (control & TCSR_TINT);
+    control = (value & ~TCSR_TINT & ~TCSR_LOAD) | interrupt;
+
+    if(starting) {
+        expires = cpu::now() + period();
+    }
+    update_interrupt();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Expire counter 1 if it's due. Periods missed while the firmware wasn't running only
+///        interrupt once, as the interrupt is still pending from the first.
+auto sim::tmrctr::step(const uint64_t time) -> void {
+    if((control & TCSR_ENT) == 0 || time < expires) {
+        return;
+    }
+
+    control |= TCSR_TINT;
+    if((control & TCSR_ENIT) != 0) {
+        interrupt_count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if((control & TCSR_ARHT) != 0) {
+        expires += period() * (((time - expires) / period()) + 1);
+    } else {
+        control &= ~TCSR_ENT;
+    }
+    update_interrupt();
+}
+
+/*------------------------------------------------------------------------------------------------*/
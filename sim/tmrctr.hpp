@@ -0,0 +1,35 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    tmrctr.hpp
+/// @brief   Simulated AXI Timer. Counter 0 counts the CPU's cycles, counter 1 generates periodic
+///          interrupts.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cstdint>
+
+/*------------------------------------------------------------------------------------------------*/
+// host side
+/*------------------------------------------------------------------------------------------------*/
+
+namespace sim::tmrctr {
+
+auto interrupts() -> uint32_t;
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// hardware side
+/*------------------------------------------------------------------------------------------------*/
+
+namespace sim::tmrctr {
+
+auto read(uint32_t offset) -> uint32_t;
+auto write(uint32_t offset, uint32_t value) -> void;
+
+auto step(uint64_t time) -> void;
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,348 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    uartlite.cpp
+/// @brief   Simulated UART Lite, with the host at the other end of the wire.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <optional>
+
+#include "xparameters.h"
+#include "xuartlite.h"
+#include "xuartlite_l.h"
+
+#include "channel.hpp"
+#include "cpu.hpp"
+#include "intc.hpp"
+#include "uartlite.hpp"
+
+/*------------------------------------------------------------------------------------------------*/
+// private types
+/*------------------------------------------------------------------------------------------------*/
+
+namespace {
+
+/// @brief One of the UART's 16 byte FIFOs.
+class Fifo {
+public:
+    auto empty() const -> bool {
+        return _size == 0;
+    }
+
+    auto full() const -> bool {
+        return _size == _bytes.size();
+    }
+
+    auto push(const uint8_t byte) -> void {
+        _bytes[(_first + _size) % XUL_FIFO_SIZE] = byte;
+        _size++;
+    }
+
+    auto pop() -> uint8_t {
+        const auto byte = _bytes[_first];
+        _first = (_first + 1) % XUL_FIFO_SIZE;
+        _size--;
+        return byte;
+    }
+
+    auto clear() -> void {
+        _first = 0;
+        _size = 0;
+    }
+
+private:
+    std::array<uint8_t, XUL_FIFO_SIZE> _bytes{};
+    uint32_t _first{0};
+    uint32_t _size{0};
+};
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// private variables
+/*------------------------------------------------------------------------------------------------*/
+
+namespace {
+
+constexpr uint8_t INPUT = XPAR_MICROBLAZE_0_AXI_INTC_AXI_UARTLITE_0_INTERRUPT_INTR;
+
+// The wire in each direction. Large enough that a test only has to drain it while it waits.
+sim::Channel<uint8_t, 4096> to_firmware{};
+sim::Channel<sim::uartlite::Wire, 1U << 18> from_firmware{};
+constinit std::atomic<uint32_t> overrun_count{0};
+
+// Only touched by the firmware's thread, inside a Critical or the tick handler.
+constinit Fifo rx_fifo{};
+constinit Fifo tx_fifo{};
+constinit bool interrupt_enabled{false};
+constinit bool overrun{false};
+
+constinit bool shifting{false};
+constinit uint8_t shift_register{0};
+constinit uint64_t shift_done_at{0};
+
+constinit uint64_t rx_line_free_at{0};
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// host side
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Queue a byte to go down the wire to the firmware at the baud rate.
+/// @return false if too much is queued already.
+auto sim::uartlite::send(const uint8_t byte) -> bool {
+    return to_firmware.push(byte);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto sim::uartlite::receive() -> std::optional<Wire> {
+    return from_firmware.pop();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Bytes that arrived to a full receive FIFO and were lost.
+auto sim::uartlite::overruns() -> uint32_t {
+    return overrun_count.load(std::memory_order_relaxed);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// hardware side
+/*------------------------------------------------------------------------------------------------*/
+
+auto sim::uartlite::read(const uint32_t offset) -> uint32_t {
+    switch(offset) {
+        case XUL_RX_FIFO_OFFSET: return rx_fifo.empty() ? 0 : rx_fifo.pop();
+
+        case XUL_STATUS_REG_OFFSET: {
+            uint32_t status = 0;
+            status |= rx_fifo.empty() ? 0U : XUL_SR_RX_FIFO_VALID_DATA;
+            status |= rx_fifo.full() ? XUL_SR_RX_FIFO_FULL : 0U;
+            status |= tx_fifo.empty() ? XUL_SR_TX_FIFO_EMPTY : 0U;
+            status |= tx_fifo.full() ? XUL_SR_TX_FIFO_FULL : 0U;
+            status |= interrupt_enabled ? XUL_SR_INTR_ENABLED : 0U;
+            status |= overrun ? XUL_SR_OVERRUN_ERROR : 0U;
+
+            // Cleared by reading.
+            overrun = false;
+            return status;
+        }
+
+        default: return 0;
+    }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto sim::uartlite::write(const uint32_t offset, const uint32_t value) -> void {
+    switch(offset) {
+        case XUL_TX_FIFO_OFFSET: {
+            // Writes to a full FIFO are ignored by the hardware. Catch them, as the firmware should
+            // never do it.
+            if(tx_fifo.full()) {
+                std::fputs("sim: write to a full UART transmit FIFO\n", stderr);
+                std::abort();
+            }
+            tx_fifo.push(static_cast<uint8_t>(value));
+            break;
+        }
+
+        case XUL_CONTROL_REG_OFFSET: {
+            if((value & XUL_CR_FIFO_RX_RESET) != 0) {
+                rx_fifo.clear();
+            }
+            if((value & XUL_CR_FIFO_TX_RESET) != 0) {
+                tx_fifo.clear();
+            }
+            interrupt_enabled = (value & XUL_CR_ENABLE_INTR) != 0;
+            break;
+        }
+
+        default: break;
+    }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Shift bytes out and in up to time. A byte written while the transmitter is idle starts
+///        at the next step, otherwise bytes go back to back. The transmit interrupt is raised when
+///        the FIFO empties into the shift register and the receive one when a byte arrives to an
+///        empty FIFO.
+auto sim::uartlite::step(const uint64_t time) -> void {
+    uint64_t start = time;
+    while(true) {
+        if(shifting) {
+            if(shift_done_at > time) {
+                break;
+            }
+
+            from_firmware.push(Wire{.byte = shift_register, .time = shift_done_at});
+            shifting = false;
+            start = shift_done_at;
+        }
+
+        if(tx_fifo.empty()) {
+            break;
+        }
+
+        shift_register = tx_fifo.pop();
+        shifting = true;
+        shift_done_at = start + BYTE_CYCLES;
+        if(tx_fifo.empty() && interrupt_enabled) {
+            intc::raise(INPUT);
+        }
+    }
+
+    while(rx_line_free_at + BYTE_CYCLES <= time) {
+        const auto byte = to_firmware.pop();
+        if(!byte) {
+            rx_line_free_at = time;
+            break;
+        }
+        rx_line_free_at += BYTE_CYCLES;
+
+        if(rx_fifo.full()) {
+            overrun = true;
+            overrun_count.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        if(rx_fifo.empty() && interrupt_enabled) {
+            intc::raise(INPUT);
+        }
+        rx_fifo.push(byte.value());
+    }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// BSP driver
+/*------------------------------------------------------------------------------------------------*/
+
+// Ported from the uartlite driver so the firmware sees the same handshakes as on hardware.
+
+namespace {
+
+XUartLite_Config config{
+    .DeviceId = XPAR_UARTLITE_0_DEVICE_ID,
+    .RegBaseAddr = XPAR_AXI_UARTLITE_0_BASEADDR,
+    .BaudRate = XPAR_AXI_UARTLITE_0_BAUDRATE,
+    .UseParity = XPAR_AXI_UARTLITE_0_USE_PARITY,
+    .ParityOdd = XPAR_AXI_UARTLITE_0_ODD_PARITY,
+    .DataBits = XPAR_AXI_UARTLITE_0_DATA_BITS,
+};
+
+void stub_handler([[maybe_unused]] void* CallBackRef, [[maybe_unused]] unsigned int ByteCount) {}
+
+auto send_buffer(XUartLite* instance) -> unsigned int {
+    const auto base = instance->RegBaseAddress;
+
+    const auto status = XUartLite_GetStatusReg(base);
+    XUartLite_WriteReg(base, XUL_CONTROL_REG_OFFSET, 0);
+
+    unsigned int sent = 0;
+    while(!XUartLite_IsTransmitFull(base) && sent < instance->SendBuffer.RemainingBytes) {
+        XUartLite_WriteReg(base, XUL_TX_FIFO_OFFSET, instance->SendBuffer.NextBytePtr[sent]);
+        sent++;
+    }
+
+    instance->SendBuffer.NextBytePtr += sent;
+    instance->SendBuffer.RemainingBytes -= sent;
+
+    XUartLite_WriteReg(base, XUL_CONTROL_REG_OFFSET, status & XUL_CR_ENABLE_INTR);
+    return sent;
+}
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+XUartLite_Config* XUartLite_LookupConfig(const u16 DeviceId) {
+    return (DeviceId == config.DeviceId) ? &config : nullptr;
+}
+
+int XUartLite_CfgInitialize(XUartLite* InstancePtr,
+                            [[maybe_unused]] XUartLite_Config* Config,
+                            const UINTPTR EffectiveAddr) {
+    *InstancePtr = XUartLite{};
+    InstancePtr->RegBaseAddress = EffectiveAddr;
+    InstancePtr->RecvHandler = stub_handler;
+    InstancePtr->SendHandler = stub_handler;
+    InstancePtr->IsReady = XIL_COMPONENT_IS_READY;
+
+    XUartLite_WriteReg(EffectiveAddr,
+                       XUL_CONTROL_REG_OFFSET,
+                       XUL_CR_FIFO_RX_RESET | XUL_CR_FIFO_TX_RESET);
+    return XST_SUCCESS;
+}
+
+/// @brief The real driver holds the interrupt off for a few cycles, far less than a byte takes, so
+///        the UART is held still for the whole call. Otherwise a tick could empty the FIFO while
+///        the interrupt's off and the edge that would carry on sending would never come.
+unsigned int XUartLite_Send(XUartLite* InstancePtr,
+                            u8* DataBufferPtr,
+                            const unsigned int NumBytes) {
+    const sim::cpu::Critical critical{};
+    const auto base = InstancePtr->RegBaseAddress;
+
+    const auto status = XUartLite_GetStatusReg(base);
+    XUartLite_WriteReg(base, XUL_CONTROL_REG_OFFSET, 0);
+
+    InstancePtr->SendBuffer.RequestedBytes = NumBytes;
+    InstancePtr->SendBuffer.RemainingBytes = NumBytes;
+    InstancePtr->SendBuffer.NextBytePtr = DataBufferPtr;
+
+    XUartLite_WriteReg(base, XUL_CONTROL_REG_OFFSET, status & XUL_CR_ENABLE_INTR);
+
+    return send_buffer(InstancePtr);
+}
+
+void XUartLite_SetSendHandler(XUartLite* InstancePtr,
+                              const XUartLite_Handler FuncPtr,
+                              void* CallBackRef) {
+    InstancePtr->SendHandler = FuncPtr;
+    InstancePtr->SendCallBackRef = CallBackRef;
+}
+
+void XUartLite_SetRecvHandler(XUartLite* InstancePtr,
+                              const XUartLite_Handler FuncPtr,
+                              void* CallBackRef) {
+    InstancePtr->RecvHandler = FuncPtr;
+    InstancePtr->RecvCallBackRef = CallBackRef;
+}
+
+void XUartLite_EnableInterrupt(XUartLite* InstancePtr) {
+    XUartLite_WriteReg(InstancePtr->RegBaseAddress, XUL_CONTROL_REG_OFFSET, XUL_CR_ENABLE_INTR);
+}
+
+void XUartLite_DisableInterrupt(XUartLite* InstancePtr) {
+    XUartLite_WriteReg(InstancePtr->RegBaseAddress, XUL_CONTROL_REG_OFFSET, 0);
+}
+
+/// @brief No receive is ever requested so the receive handler is always told 0 bytes. The send
+///        handler is told once the whole of the last send has gone into the FIFO.
+void XUartLite_InterruptHandler(XUartLite* InstancePtr) {
+    const auto status = XUartLite_GetStatusReg(InstancePtr->RegBaseAddress);
+
+    if((status & (XUL_SR_RX_FIFO_FULL | XUL_SR_RX_FIFO_VALID_DATA)) != 0) {
+        InstancePtr->RecvHandler(InstancePtr->RecvCallBackRef, 0);
+    }
+
+    if((status & XUL_SR_TX_FIFO_EMPTY) != 0 && InstancePtr->SendBuffer.RequestedBytes > 0) {
+        if(InstancePtr->SendBuffer.RemainingBytes == 0) {
+            const auto requested = InstancePtr->SendBuffer.RequestedBytes;
+            InstancePtr->SendBuffer.RequestedBytes = 0;
+            InstancePtr->SendHandler(InstancePtr->SendCallBackRef, requested);
+        } else {
+            send_buffer(InstancePtr);
+        }
+    }
+}
+
+/*------------------------------------------------------------------------------------------------*/
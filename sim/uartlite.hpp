@@ -0,0 +1,60 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    uartlite.hpp
+/// @brief   Simulated UART Lite, with the host at the other end of the wire.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cstdint>
+#include <optional>
+
+#include "xparameters.h"
+
+#include "cpu.hpp"
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace sim::uartlite {
+
+constexpr uint32_t BAUD = XPAR_AXI_UARTLITE_0_BAUDRATE;
+
+/// @brief A start bit, 8 data bits and a stop bit.
+constexpr uint32_t BYTE_CYCLES = cpu::FREQUENCY / (BAUD / 10);
+
+/// @brief A byte the firmware sent and when its stop bit finished.
+struct Wire {
+    uint8_t byte;
+    uint64_t time;
+};
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// host side
+/*------------------------------------------------------------------------------------------------*/
+
+namespace sim::uartlite {
+
+auto send(uint8_t byte) -> bool;
+
+auto receive() -> std::optional<Wire>;
+
+auto overruns() -> uint32_t;
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// hardware side
+/*------------------------------------------------------------------------------------------------*/
+
+namespace sim::uartlite {
+
+auto read(uint32_t offset) -> uint32_t;
+auto write(uint32_t offset, uint32_t value) -> void;
+
+auto step(uint64_t time) -> void;
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,123 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    coroutine.cpp
+/// @brief   Stackless coroutine tasks with statically allocated frames, and their executor.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "coroutine.hpp"
+
+/*------------------------------------------------------------------------------------------------*/
+// private variables
+/*------------------------------------------------------------------------------------------------*/
+
+namespace {
+
+struct alignas(std::max_align_t) Frame {
+    std::array<std::byte, coroutine::FRAME_SLOT_SIZE> bytes;
+};
+
+constinit std::array<Frame, coroutine::FRAME_SLOTS> frames{};
+constinit std::array<bool, coroutine::FRAME_SLOTS> frame_used{};
+
+// Largest frame asked for so far, whether or not it fit.
+constinit std::size_t largest{0};
+
+// Registered tasks. Each is owned elsewhere and may be replaced in place by moving a new task in.
+constinit std::array<coroutine::Task*, coroutine::TASKS_MAX> tasks{};
+constinit uint32_t task_count{0};
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// public functions
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Take a free frame slot. Only called from the main loop, never from an ISR.
+/// @return nullptr if size won't fit in a slot or there are no slots left.
+auto coroutine::allocate(const std::size_t size) -> void* {
+    largest = std::max(largest, size);
+
+    if(size > FRAME_SLOT_SIZE) {
+        return nullptr;
+    }
+
+    for(uint32_t slot = 0; slot < FRAME_SLOTS; slot++) {
+        if(!frame_used[slot]) {
+            frame_used[slot] = true;
+            return frames[slot].bytes.data();
+        }
+    }
+    return nullptr;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto coroutine::deallocate(void* const frame) -> void {
+    for(uint32_t slot = 0; slot < FRAME_SLOTS; slot++) {
+        if(frames[slot].bytes.data() == frame) {
+            frame_used[slot] = false;
+            return;
+        }
+    }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Largest frame any task has needed, to size FRAME_SLOT_SIZE against.
+auto coroutine::largest_frame() -> std::size_t {
+    return largest;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Have the executor run task. Registering the same task again does nothing.
+/// @return false if the executor is full.
+auto coroutine::spawn(Task& task) -> bool {
+    const auto registered = std::span(tasks).first(task_count);
+    if(std::ranges::find(registered, &task) != registered.end()) {
+        return true;
+    }
+
+    if(task_count == TASKS_MAX) {
+        return false;
+    }
+
+    tasks[task_count++] = &task;
+    return true;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Resume ready tasks in turn until none are ready or budget resumes have been made.
+/// @return true if tasks were left ready when the budget ran out.
+auto coroutine::run(const uint32_t budget) -> bool {
+    uint32_t resumed = 0;
+    bool progress = true;
+
+    while(progress) {
+        progress = false;
+        for(auto* const task : std::span(tasks).first(task_count)) {
+            if(!task->ready()) {
+                continue;
+            }
+
+            if(resumed == budget) {
+                return true;
+            }
+
+            task->resume();
+            resumed++;
+            progress = true;
+        }
+    }
+    return false;
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,212 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    coroutine.hpp
+/// @brief   Stackless coroutine tasks with statically allocated frames, and their executor.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+/*------------------------------------------------------------------------------------------------*/
+// public constants
+/*------------------------------------------------------------------------------------------------*/
+
+namespace coroutine {
+
+/// @brief Frames come from a fixed arena of equal slots, never the heap. A frame larger than a slot
+///        fails to allocate, as does one with every slot taken.
+constexpr uint32_t FRAME_SLOTS = 4;
+constexpr uint32_t FRAME_SLOT_SIZE = 256;
+
+/// @brief Most tasks the executor can run.
+constexpr uint32_t TASKS_MAX = 4;
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// frame allocation
+/*------------------------------------------------------------------------------------------------*/
+
+namespace coroutine {
+
+auto allocate(std::size_t size) -> void*;
+auto deallocate(void* frame) -> void;
+
+auto largest_frame() -> std::size_t;
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// public types
+/*------------------------------------------------------------------------------------------------*/
+
+namespace coroutine {
+
+/// @brief A coroutine run by the executor. Starts suspended and owns its frame, which is destroyed
+///        along with it. A task whose frame couldn't be allocated is empty and never runs.
+class Task {
+public:
+    class promise_type {
+    public:
+        static auto operator new(const std::size_t size) noexcept -> void* {
+            return allocate(size);
+        }
+
+        static auto operator delete(void* const frame) -> void {
+            deallocate(frame);
+        }
+
+        static auto get_return_object_on_allocation_failure() -> Task {
+            return Task{};
+        }
+
+        auto get_return_object() -> Task {
+            return Task{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+
+        auto initial_suspend() noexcept -> std::suspend_always {
+            return {};
+        }
+
+        auto final_suspend() noexcept -> std::suspend_always {
+            return {};
+        }
+
+        auto return_void() -> void {}
+
+        auto unhandled_exception() -> void {}
+
+        /// @brief Suspend until poll(awaiter) returns true. Without a poll the task is ready as
+        ///        soon as it's suspended.
+        auto wait(void* const awaiter, auto (*const poll)(void*)->bool) -> void {
+            _awaiter = awaiter;
+            _poll = poll;
+        }
+
+        auto ready() -> bool {
+            return _poll == nullptr || _poll(_awaiter);
+        }
+
+    private:
+        void* _awaiter{nullptr};
+        auto (*_poll)(void*) -> bool {nullptr};
+    };
+
+    constexpr Task() = default;
+
+    Task(const Task&) = delete;
+    auto operator=(const Task&) -> Task& = delete;
+
+    Task(Task&& other) noexcept : _handle{std::exchange(other._handle, nullptr)} {}
+
+    auto operator=(Task&& other) noexcept -> Task& {
+        if(this != &other) {
+            reset();
+            _handle = std::exchange(other._handle, nullptr);
+        }
+        return *this;
+    }
+
+    ~Task() {
+        reset();
+    }
+
+    auto valid() const -> bool {
+        return static_cast<bool>(_handle);
+    }
+
+    /// @brief true if the task can be resumed now.
+    auto ready() const -> bool {
+        return _handle && !_handle.done() && _handle.promise().ready();
+    }
+
+    /// @brief Run the task until it next suspends. Must only be called when ready().
+    auto resume() -> void {
+        _handle.promise().wait(nullptr, nullptr);
+        _handle.resume();
+    }
+
+    auto reset() -> void {
+        if(_handle) {
+            _handle.destroy();
+            _handle = nullptr;
+        }
+    }
+
+private:
+    std::coroutine_handle<promise_type> _handle{nullptr};
+
+    explicit Task(const std::coroutine_handle<promise_type> handle) : _handle{handle} {}
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Awaiter suspending a task until its condition is met. The condition is polled each time
+///        the executor considers the task and is free to do work of its own. Whatever it returns
+///        once it's met is the result of the co_await.
+template<typename Condition>
+class Until {
+public:
+    using Result = std::invoke_result_t<Condition&>;
+
+    explicit Until(Condition condition) : _condition{std::move(condition)} {}
+
+    auto await_ready() -> bool {
+        return poll(this);
+    }
+
+    auto await_suspend(const std::coroutine_handle<Task::promise_type> handle) -> void {
+        handle.promise().wait(this, poll);
+    }
+
+    auto await_resume() -> Result {
+        return std::move(_result);
+    }
+
+private:
+    Condition _condition;
+    Result _result{};
+
+    /// @brief Stops calling the condition once it's met so a result can't be lost.
+    static auto poll(void* const awaiter) -> bool {
+        auto& self = *static_cast<Until*>(awaiter);
+        if(!self._result) {
+            self._result = self._condition();
+        }
+        return static_cast<bool>(self._result);
+    }
+};
+
+/// @brief co_await until(condition) suspends until condition() returns something true.
+template<typename Condition>
+auto until(Condition condition) -> Until<Condition> {
+    return Until<Condition>{std::move(condition)};
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief co_await yield() gives the other tasks a turn and counts against the executor's budget.
+inline auto yield() -> std::suspend_always {
+    return {};
+}
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// executor
+/*------------------------------------------------------------------------------------------------*/
+
+namespace coroutine {
+
+auto spawn(Task& task) -> bool;
+
+auto run(uint32_t budget) -> bool;
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
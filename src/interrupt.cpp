@@ -5,11 +5,15 @@
 /// @brief   Interrupt module.
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+#include <algorithm>
+#include <bit>
 #include <string_view>
 
+#include "mb_interface.h"
 #include "xintc.h"
 
 #include "interrupt.hpp"
+#include "timer.hpp"
 
 /*------------------------------------------------------------------------------------------------*/
 
@@ -18,6 +22,108 @@ namespace {
 constexpr uint16_t CONTROLLER_DEVICE_ID = XPAR_INTC_0_DEVICE_ID;
 constinit XIntc controller{};
 
+auto interrupts_enabled() -> bool;
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// profiling
+/*------------------------------------------------------------------------------------------------*/
+
+#ifdef INTERRUPT_PROFILING
+
+namespace {
+
+// Dispatched handlers are connected through profiled_isr(), which times them and calls the real
+// handler. Entry latency is measured from a timestamp taken first thing in dispatch(), the earliest
+// code of ours run once the BSP has saved context. It covers the dispatch itself and time spent
+// waiting behind other handlers in the same dispatch. It can't see how long the request was pending
+// before the processor took it, as the controller doesn't timestamp requests. That wait is bounded
+// by the longest window interrupts were held off, recorded as MASKED_PROFILE, plus the longest run
+// of any other handler. Vectored handlers skip the dispatcher so have no latency to record.
+//
+// Without a timer every time reads 0, so only the counts mean anything.
+struct Connection {
+    interrupt::Interrupt interrupt;
+    interrupt::Handler handler;
+    void* callback_ref;
+};
+
+constinit std::array<Connection, interrupt::COUNT> connections{};
+constinit std::array<interrupt::Profile, interrupt::COUNT> profiles{};
+constinit volatile uint32_t dispatch_start{0};
+constinit interrupt::Profile masked{};
+
+auto record(const interrupt::Interrupt interrupt, const uint32_t cycles) -> void {
+    auto& profile = profiles[interrupt];
+    profile.count++;
+    profile.total_cycles += cycles;
+    profile.max_cycles = std::max(profile.max_cycles, cycles);
+}
+
+auto latency_bucket(const uint32_t cycles) -> uint32_t {
+    const auto bucket = std::bit_width(cycles / interrupt::LATENCY_BUCKET_MIN);
+    return std::min<uint32_t>(bucket, interrupt::LATENCY_BUCKETS - 1);
+}
+
+auto record_latency(const interrupt::Interrupt interrupt, const uint32_t cycles) -> void {
+    profiles[interrupt].latency[latency_bucket(cycles)]++;
+}
+
+auto record_masked(const uint32_t cycles) -> void {
+    masked.count++;
+    masked.total_cycles += cycles;
+    masked.max_cycles = std::max(masked.max_cycles, cycles);
+    masked.latency[latency_bucket(cycles)]++;
+}
+
+void dispatch(void* callback_ref) {
+    dispatch_start = timer::now();
+    XIntc_InterruptHandler(static_cast<XIntc*>(callback_ref));
+}
+
+void profiled_isr(void* callback_ref) {
+    const auto& connection = *static_cast<const Connection*>(callback_ref);
+
+    const auto start = timer::now();
+    record_latency(connection.interrupt, start - dispatch_start);
+
+    connection.handler(connection.callback_ref);
+
+    record(connection.interrupt, timer::now() - start);
+}
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+interrupt::ProfileScope::ProfileScope(const Interrupt interrupt)
+    : _interrupt(interrupt), _start(timer::now()) {}
+
+interrupt::ProfileScope::~ProfileScope() {
+    record(_interrupt, timer::now() - _start);
+}
+
+#endif
+
+/*------------------------------------------------------------------------------------------------*/
+
+interrupt::Lock::Lock() : _was_enabled{interrupts_enabled()} {
+    if(_was_enabled) {
+        microblaze_disable_interrupts();
+#ifdef INTERRUPT_PROFILING
+        _start = timer::now();
+#endif
+    }
+}
+
+interrupt::Lock::~Lock() {
+    if(_was_enabled) {
+#ifdef INTERRUPT_PROFILING
+        record_masked(timer::now() - _start);
+#endif
+        microblaze_enable_interrupts();
+    }
 }
 
 /*------------------------------------------------------------------------------------------------*/
@@ -31,28 +137,57 @@ auto interrupt::init() -> Status {
         return Status::SelfTestFailure;
     }
 
+    // Sources are enabled individually as they're connected.
+    if(XIntc_Start(&controller, XIN_REAL_MODE) != XST_SUCCESS) {
+        return Status::InitFailure;
+    }
+
+    Xil_ExceptionInit();
+#ifdef INTERRUPT_PROFILING
+    Xil_ExceptionRegisterHandler(XIL_EXCEPTION_ID_INT, dispatch, &controller);
+#else
+    Xil_ExceptionRegisterHandler(XIL_EXCEPTION_ID_INT,
+                                 (Xil_ExceptionHandler)XIntc_InterruptHandler,
+                                 &controller);
+#endif
+    Xil_ExceptionEnable();
+
     return Status::Ok;
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
-auto interrupt::enable(Interrupt interrupt, XInterruptHandler callback, void* callback_ref) -> Status {
+/// @brief Connect an interrupt to the controller's dispatch loop. The handler must acknowledge it.
+auto interrupt::enable(Interrupt interrupt, Handler callback, void* callback_ref) -> Status {
+
+#ifdef INTERRUPT_PROFILING
+    connections[interrupt] = Connection{.interrupt = interrupt,
+                                        .handler = callback,
+                                        .callback_ref = callback_ref};
+    callback = profiled_isr;
+    callback_ref = &connections[interrupt];
+#endif
 
-    if(XIntc_Connect(&controller, interrupt, (XInterruptHandler)callback, callback_ref) != XST_SUCCESS) {
+    if(XIntc_Connect(&controller, interrupt, callback, callback_ref) != XST_SUCCESS) {
         return Status::InitFailure;
     }
 
-    if(XIntc_Start(&controller, XIN_REAL_MODE) != XST_SUCCESS) {
+    XIntc_Enable(&controller, interrupt);
+
+    return Status::Ok;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Connect an interrupt to its own vector so the processor jumps straight to the handler,
+///        skipping the dispatch loop. The processor acknowledges it on entry.
+auto interrupt::enable_fast(Interrupt interrupt, FastHandler handler) -> Status {
+
+    if(XIntc_ConnectFastHandler(&controller, interrupt, handler) != XST_SUCCESS) {
         return Status::InitFailure;
     }
 
     XIntc_Enable(&controller, interrupt);
-    Xil_ExceptionInit();
-
-    Xil_ExceptionRegisterHandler(XIL_EXCEPTION_ID_INT,
-                                 (Xil_ExceptionHandler)XIntc_InterruptHandler,
-                                 &controller);
-    Xil_ExceptionEnable();
 
     return Status::Ok;
 }
@@ -63,6 +198,41 @@ auto interrupt::acknowledge(Interrupt interrupt) -> void {
     XIntc_Acknowledge(&controller, interrupt);
 }
 
+/*------------------------------------------------------------------------------------------------*/
+
+/// @return std::nullopt if profiling isn't built in.
+auto interrupt::profile([[maybe_unused]] Interrupt interrupt) -> std::optional<Profile> {
+#ifdef INTERRUPT_PROFILING
+    return profiles[interrupt];
+#else
+    return std::nullopt;
+#endif
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @return std::nullopt if profiling isn't built in.
+auto interrupt::masked_profile() -> std::optional<Profile> {
+#ifdef INTERRUPT_PROFILING
+    return masked;
+#else
+    return std::nullopt;
+#endif
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// private functions
+/*------------------------------------------------------------------------------------------------*/
+
+namespace {
+
+auto interrupts_enabled() -> bool {
+    constexpr uint32_t MSR_IE = 0x2;
+    return (mfmsr() & MSR_IE) != 0;
+}
+
+}
+
 /*------------------------------------------------------------------------------------------------*/
 // Error handling.
 /*------------------------------------------------------------------------------------------------*/
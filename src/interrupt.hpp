@@ -6,10 +6,12 @@
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma once
 
+#include <array>
 #include <cstdint>
+#include <optional>
 #include <string_view>
 
-#include "xintc.h"
+#include "xparameters.h"
 
 /*------------------------------------------------------------------------------------------------*/
 // error handling.
@@ -37,15 +39,111 @@ enum Interrupt : uint8_t {
     MotorReverse = XPAR_MICROBLAZE_0_AXI_INTC_STEPPER_MOTOR_LINE_REVERSE_TICK_INTR,
     HeadActiveStart = XPAR_MICROBLAZE_0_AXI_INTC_THERMAL_HEAD_HEAD_ACTIVE_START_TICK_INTR,
     HeadActiveEnd = XPAR_MICROBLAZE_0_AXI_INTC_THERMAL_HEAD_HEAD_ACTIVE_END_TICK_INTR,
+    BurnBuffer = XPAR_MICROBLAZE_0_AXI_INTC_BURN_BUFFER_INTERRUPT_INTR,
 
     Uart = XPAR_MICROBLAZE_0_AXI_INTC_AXI_UARTLITE_0_INTERRUPT_INTR,
     ThermistorSpi = XPAR_MICROBLAZE_0_AXI_INTC_AXI_SPI_THERMISTOR_IP2INTC_IRPT_INTR,
     FlashSpi = XPAR_MICROBLAZE_0_AXI_INTC_AXI_QUAD_SPI_FLASH_IP2INTC_IRPT_INTR,
 
+#ifdef XPAR_INTC_0_TMRCTR_0_VEC_ID
+    Timer = XPAR_INTC_0_TMRCTR_0_VEC_ID,
+#endif
+
 };
 
 using enum Interrupt;
 
+/// @brief Interrupt service routine. Matches the BSP's XInterruptHandler so drivers' own handlers
+///        can be connected directly.
+using Handler = void (*)(void* callback_ref);
+
+constexpr uint32_t COUNT = XPAR_INTC_MAX_NUM_INTR_INPUTS;
+
+/// Profiling is built in with the interrupt_profiling meson option.
+#ifdef INTERRUPT_PROFILING
+constexpr bool PROFILING = true;
+#else
+constexpr bool PROFILING = false;
+#endif
+
+/// @brief Entry latencies are counted in power of two buckets of cycles. The first counts anything
+///        under LATENCY_BUCKET_MIN and the last anything too long for the others.
+constexpr uint32_t LATENCY_BUCKETS = 8;
+constexpr uint32_t LATENCY_BUCKET_MIN = 16;
+
+/// @brief Profile number reported for the windows main code held interrupts off with a Lock.
+///        Their count, total and longest length in cycles, with lengths bucketed as latencies are.
+constexpr uint8_t MASKED_PROFILE = 0xFF;
+
+/// @brief What an interrupt has cost since start up.
+struct Profile {
+    uint32_t count;
+    uint64_t total_cycles;
+    uint32_t max_cycles;
+    std::array<uint32_t, LATENCY_BUCKETS> latency;
+};
+
+/// @brief Vectored interrupt service routine. Must be declared [[gnu::fast_interrupt]] so it saves
+///        what it uses and returns from the interrupt itself.
+using FastHandler = void (*)();
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// profiling.
+/*------------------------------------------------------------------------------------------------*/
+
+namespace interrupt {
+
+/// @brief Profiles a vectored handler from construction to destruction. Dispatched handlers are
+///        profiled automatically. Does nothing unless profiling is built in.
+class ProfileScope {
+public:
+#ifdef INTERRUPT_PROFILING
+    explicit ProfileScope(Interrupt interrupt);
+    ~ProfileScope();
+
+    ProfileScope(const ProfileScope&) = delete;
+    auto operator=(const ProfileScope&) -> ProfileScope& = delete;
+
+private:
+    Interrupt _interrupt;
+    uint32_t _start;
+#else
+    explicit ProfileScope([[maybe_unused]] Interrupt interrupt) {}
+#endif
+};
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// critical sections.
+/*------------------------------------------------------------------------------------------------*/
+
+namespace interrupt {
+
+/// @brief Holds interrupts off while it exists, if they were on. Taken in an ISR, where they're
+///        already off, it does nothing. With profiling built in the time they're held off is
+///        recorded, as no handler's latency can see it.
+class Lock {
+public:
+    Lock();
+    ~Lock();
+
+    Lock(const Lock&) = delete;
+    auto operator=(const Lock&) -> Lock& = delete;
+
+    auto was_enabled() const -> bool {
+        return _was_enabled;
+    }
+
+private:
+    bool _was_enabled;
+#ifdef INTERRUPT_PROFILING
+    uint32_t _start;
+#endif
+};
+
 }
 
 /*------------------------------------------------------------------------------------------------*/
@@ -56,10 +154,14 @@ namespace interrupt {
 
 auto init() -> Status;
 
-auto enable(Interrupt interrupt, XInterruptHandler callback, void* callback_ref) -> Status;
+auto enable(Interrupt interrupt, Handler callback, void* callback_ref) -> Status;
+auto enable_fast(Interrupt interrupt, FastHandler handler) -> Status;
 
 auto acknowledge(Interrupt interrupt) -> void;
 
+auto profile(Interrupt interrupt) -> std::optional<Profile>;
+auto masked_profile() -> std::optional<Profile>;
+
 auto status_message(Status status) -> std::string_view;
 
 }
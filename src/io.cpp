@@ -1,10 +1,14 @@
+#include <array>
 #include <cstdint>
-#include <utility>
 
 #include "xgpio.h"
+#include "xgpio_l.h"
+#include "xil_io.h"
 #include "xparameters.h"
 
+#include "interrupt.hpp"
 #include "io.hpp"
+#include "timer.hpp"
 
 /*------------------------------------------------------------------------------------------------*/
 // private types
@@ -14,9 +18,35 @@ namespace {
 
 enum class Direction : uint8_t { Input, Output };
 
-struct GPIOConfig {
+/// @brief A channel of a GPIO device. Every pin on a port is written in one go.
+enum Port : uint8_t {
+    Leds,
+    RgbLed,
+    Buttons,
+    PaperSensor,
+    PlatenSensor,
+};
+
+constexpr uint32_t PORT_COUNT = 5;
+
+struct PortConfig {
     uint16_t id;
     uint8_t channel;
+};
+
+enum Pin : uint8_t {
+    Monoled1,
+    Monoled2,
+    Rgb,
+    Button,
+    Paper,
+    Platen,
+};
+
+constexpr uint32_t PIN_COUNT = 6;
+
+struct PinConfig {
+    Port port;
     Direction direction;
     uint32_t mask;
 };
@@ -29,54 +59,49 @@ struct GPIOConfig {
 
 namespace {
 
-constexpr auto MONOLED_1_CONFIG = GPIOConfig{
-    .id = XPAR_AXI_GPIO_LED_DEVICE_ID,
-    .channel = 1,
-    .direction = Direction::Output,
-    .mask = 0b01,
-};
-
-constexpr auto MONOLED_2_CONFIG = GPIOConfig{
-    .id = XPAR_AXI_GPIO_LED_DEVICE_ID,
-    .channel = 1,
-    .direction = Direction::Output,
-    .mask = 0b10,
-};
-
-constexpr auto RGB_LED_CONFIG = GPIOConfig{
-    .id = XPAR_AXI_GPIO_LED_DEVICE_ID,
-    .channel = 2,
-    .direction = Direction::Output,
-    .mask = 0b111,
-};
-
-constexpr auto BUTTON_CONFIG = GPIOConfig{
-    .id = XPAR_AXI_GPIO_BUTTONS_DEVICE_ID,
-    .channel = 1,
-    .direction = Direction::Input,
-    .mask = 0b1,
-};
+constexpr std::array<PortConfig, PORT_COUNT> PORTS{{
+    {.id = XPAR_AXI_GPIO_LED_DEVICE_ID, .channel = 1},
+    {.id = XPAR_AXI_GPIO_LED_DEVICE_ID, .channel = 2},
+    {.id = XPAR_AXI_GPIO_BUTTONS_DEVICE_ID, .channel = 1},
+    {.id = XPAR_AXI_GPIO_PAPER_SENSOR_CONTROL_DEVICE_ID, .channel = 1},
+    {.id = XPAR_AXI_GPIO_PLATEN_SENSOR_CONTROL_DEVICE_ID, .channel = 1},
+}};
+
+constexpr std::array<PinConfig, PIN_COUNT> PINS{{
+    {.port = Leds, .direction = Direction::Output, .mask = 0b01},
+    {.port = Leds, .direction = Direction::Output, .mask = 0b10},
+    {.port = RgbLed, .direction = Direction::Output, .mask = 0b111},
+    {.port = Buttons, .direction = Direction::Input, .mask = 0b1},
+    {.port = PaperSensor, .direction = Direction::Output, .mask = 0b1},
+    {.port = PlatenSensor, .direction = Direction::Output, .mask = 0b1},
+}};
+
+/// @brief Pins on port in direction.
+constexpr auto port_mask(const Port port, const Direction direction) -> uint32_t {
+    uint32_t mask = 0;
+    for(const auto& pin : PINS) {
+        if(pin.port == port && pin.direction == direction) {
+            mask |= pin.mask;
+        }
+    }
+    return mask;
+}
 
-constexpr auto PAPER_SENSOR_CONFIG = GPIOConfig{
-    .id = XPAR_AXI_GPIO_PAPER_SENSOR_CONTROL_DEVICE_ID,
-    .channel = 1,
-    .direction = Direction::Output,
-    .mask = 0b1,
-};
+/// Inputs are read at most this often, which also debounces them. Without a timer there's no time
+/// to go by so reads are counted instead.
+constexpr uint32_t INPUT_SAMPLE_CYCLES = timer::FREQUENCY / 100;
+constexpr uint32_t INPUT_SAMPLE_READS = 256;
 
-constexpr auto PLATEN_SENSOR_CONFIG = GPIOConfig{
-    .id = XPAR_AXI_GPIO_PLATEN_SENSOR_CONTROL_DEVICE_ID,
-    .channel = 1,
-    .direction = Direction::Output,
-    .mask = 0b1,
-};
+// Data register of each port, what's wanted on it and what was last written to it. Outputs are
+// only written when their shadow changes, and only once per batch.
+constinit std::array<UINTPTR, PORT_COUNT> data_registers{};
+constinit std::array<uint32_t, PORT_COUNT> shadow{};
+constinit std::array<uint32_t, PORT_COUNT> written{};
+constinit uint32_t dirty_ports{0};
+constinit uint32_t batch_depth{0};
 
-XGpio monoled_1{};
-XGpio monoled_2{};
-XGpio rgb_led{};
-XGpio button{};
-XGpio paper_sensor{};
-XGpio platen_sensor{};
+constinit uint32_t last_sample_time{0};
+constinit uint32_t reads_since_sample{0};
 
 }
 
@@ -86,13 +111,18 @@ XGpio platen_sensor{};
 
 namespace {
 
-auto gpio_init(const GPIOConfig& config) -> XGpio;
+auto port_init(Port port) -> void;
 
-auto gpio_set_high(XGpio instance, const GPIOConfig& config) -> void;
-auto gpio_set_low(XGpio instance, const GPIOConfig& config) -> void;
+template<Pin PIN>
+auto write(uint32_t value) -> void;
 
-auto gpio_is_high(XGpio instance, const GPIOConfig& config) -> bool;
-auto gpio_is_low(XGpio instance, const GPIOConfig& config) -> bool;
+template<Pin PIN>
+auto read() -> uint32_t;
+
+auto flush() -> void;
+
+auto sample_due() -> bool;
+auto sample() -> void;
 
 }
 
@@ -101,72 +131,86 @@ auto gpio_is_low(XGpio instance, const GPIOConfig& config) -> bool;
 /*------------------------------------------------------------------------------------------------*/
 
 auto io::init() -> void {
-    monoled_1 = gpio_init(MONOLED_1_CONFIG);
-    monoled_2 = gpio_init(MONOLED_2_CONFIG);
-    rgb_led = gpio_init(RGB_LED_CONFIG);
-    button = gpio_init(BUTTON_CONFIG);
-    paper_sensor = gpio_init(PAPER_SENSOR_CONFIG);
-    platen_sensor = gpio_init(PLATEN_SENSOR_CONFIG);
+    for(uint8_t port = 0; port < PORT_COUNT; port++) {
+        port_init(static_cast<Port>(port));
+    }
+    sample();
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
 auto io::monoled_1_on() -> void {
-    gpio_set_high(monoled_1, MONOLED_1_CONFIG);
+    write<Monoled1>(UINT32_MAX);
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
 auto io::monoled_2_on() -> void {
-    gpio_set_high(monoled_2, MONOLED_2_CONFIG);
+    write<Monoled2>(UINT32_MAX);
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
 auto io::monoled_1_off() -> void {
-    gpio_set_low(monoled_1, MONOLED_1_CONFIG);
+    write<Monoled1>(0);
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
 auto io::monoled_2_off() -> void {
-    gpio_set_low(monoled_2, MONOLED_2_CONFIG);
+    write<Monoled2>(0);
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
 auto io::rgb_led_set(const LEDColour colour) -> void {
-    XGpio_DiscreteWrite(&rgb_led, RGB_LED_CONFIG.channel, static_cast<uint32_t>(colour));
+    write<Rgb>(static_cast<uint32_t>(colour));
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @brief Button state as of the last sample, which is taken again if it's due.
 auto io::button_is_pressed() -> bool {
-    return gpio_is_high(button, BUTTON_CONFIG);
+    return read<Button>() != 0;
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
 auto io::paper_in() -> void {
-    gpio_set_high(paper_sensor, PAPER_SENSOR_CONFIG);
+    write<Paper>(UINT32_MAX);
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
 auto io::paper_out() -> void {
-    gpio_set_low(paper_sensor, PAPER_SENSOR_CONFIG);
+    write<Paper>(0);
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
 auto io::platen_in() -> void {
-    gpio_set_high(platen_sensor, PLATEN_SENSOR_CONFIG);
+    write<Platen>(UINT32_MAX);
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
 auto io::platen_out() -> void {
-    gpio_set_low(platen_sensor, PLATEN_SENSOR_CONFIG);
+    write<Platen>(0);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+io::Batch::Batch() {
+    batch_depth++;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+io::Batch::~Batch() {
+    const interrupt::Lock lock{};
+    if(--batch_depth == 0) {
+        flush();
+    }
 }
 
 /*------------------------------------------------------------------------------------------------*/
@@ -175,50 +219,112 @@ auto io::platen_out() -> void {
 
 namespace {
 
-auto gpio_init(const GPIOConfig& config) -> XGpio {
-    XGpio_Config* xgpio_config = XGpio_LookupConfig(config.id);
+/// @brief Set the port's pin directions and take its current outputs as the shadow.
+auto port_init(const Port port) -> void {
+    const auto& config = PORTS[port];
+    const XGpio_Config* const xgpio_config = XGpio_LookupConfig(config.id);
 
-    XGpio instance = {};
-    XGpio_CfgInitialize(&instance, xgpio_config, xgpio_config->BaseAddress);
+    const UINTPTR base = xgpio_config->BaseAddress + ((config.channel - 1U) * XGPIO_CHAN_OFFSET);
+    const UINTPTR tri_register = base + XGPIO_TRI_OFFSET;
+    data_registers[port] = base + XGPIO_DATA_OFFSET;
 
-    const auto value = XGpio_GetDataDirection(&instance, config.channel);
-    if(config.direction == Direction::Output) {
-        XGpio_SetDataDirection(&instance, config.channel, value & ~config.mask);
-    } else {
-        XGpio_SetDataDirection(&instance, config.channel, value | config.mask);
-    }
+    const uint32_t inputs = port_mask(port, Direction::Input);
+    const uint32_t outputs = port_mask(port, Direction::Output);
+    Xil_Out32(tri_register, (Xil_In32(tri_register) & ~outputs) | inputs);
 
-    return instance;
+    shadow[port] = Xil_In32(data_registers[port]);
+    written[port] = shadow[port];
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
-auto gpio_set_high(XGpio instance, const GPIOConfig& config) -> void {
-    if(config.direction != Direction::Output) {
+/// @brief Set the pin's bits to those in value. Written straight away unless a batch is open.
+template<Pin PIN>
+auto write(const uint32_t value) -> void {
+    constexpr auto config = PINS[PIN];
+    static_assert(config.direction == Direction::Output, "Only output pins can be written");
+
+    // Outputs are written from ISRs too.
+    const interrupt::Lock lock{};
+
+    const uint32_t updated = (shadow[config.port] & ~config.mask) | (value & config.mask);
+    if(updated != shadow[config.port]) {
+        shadow[config.port] = updated;
+        dirty_ports |= 1U << config.port;
+    }
+
+    if(batch_depth == 0) {
+        flush();
         return;
     }
-    XGpio_DiscreteSet(&instance, config.channel, config.mask);
+
+    // An ISR can't wait for the main loop to close its batch, so its pin goes out straight away.
+    // Whatever the batch has changed, on this port or any other, is left for the batch to write.
+    if(!lock.was_enabled()) {
+        const uint32_t pin_only = (written[config.port] & ~config.mask) | (updated & config.mask);
+        if(pin_only != written[config.port]) {
+            Xil_Out32(data_registers[config.port], pin_only);
+            written[config.port] = pin_only;
+        }
+    }
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
-auto gpio_set_low(XGpio instance, const GPIOConfig& config) -> void {
-    if(config.direction != Direction::Output) {
-        return;
+template<Pin PIN>
+auto read() -> uint32_t {
+    constexpr auto config = PINS[PIN];
+    static_assert(config.direction == Direction::Input, "Only input pins can be read");
+
+    if(sample_due()) {
+        sample();
+    }
+    return shadow[config.port] & config.mask;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Write every port that's changed since the last flush. Called with interrupts held off so
+///        that the ports change back to back.
+auto flush() -> void {
+    uint32_t dirty = dirty_ports;
+    for(uint8_t port = 0; dirty != 0; port++, dirty >>= 1) {
+        if((dirty & 1U) != 0 && shadow[port] != written[port]) {
+            Xil_Out32(data_registers[port], shadow[port]);
+            written[port] = shadow[port];
+        }
     }
-    XGpio_DiscreteClear(&instance, config.channel, config.mask);
+    dirty_ports = 0;
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
-auto gpio_is_high(XGpio instance, const GPIOConfig& config) -> bool {
-    return XGpio_DiscreteRead(&instance, config.channel) != 0;
+auto sample_due() -> bool {
+    if constexpr(timer::AVAILABLE) {
+        const auto now = timer::now();
+        if(now - last_sample_time < INPUT_SAMPLE_CYCLES) {
+            return false;
+        }
+        last_sample_time = now;
+    } else {
+        if(++reads_since_sample < INPUT_SAMPLE_READS) {
+            return false;
+        }
+        reads_since_sample = 0;
+    }
+    return true;
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
-auto gpio_is_low(XGpio instance, const GPIOConfig& config) -> bool {
-    return XGpio_DiscreteRead(&instance, config.channel) == 0;
+/// @brief Read every port with inputs on it.
+auto sample() -> void {
+    for(uint8_t port = 0; port < PORT_COUNT; port++) {
+        const uint32_t inputs = port_mask(static_cast<Port>(port), Direction::Input);
+        if(inputs != 0) {
+            shadow[port] = (shadow[port] & ~inputs) | (Xil_In32(data_registers[port]) & inputs);
+        }
+    }
 }
 
 }
@@ -41,6 +41,18 @@ auto paper_out() -> void;
 auto platen_in() -> void;
 auto platen_out() -> void;
 
+/// @brief Holds back output changes while it exists then writes each GPIO channel that changed
+///        once, however many of its pins were set. Batches may be nested. Pins an ISR sets while
+///        one is open are written straight away, without the changes it's holding back.
+class Batch {
+public:
+    Batch();
+    ~Batch();
+
+    Batch(const Batch&) = delete;
+    auto operator=(const Batch&) -> Batch& = delete;
+};
+
 }
 
 /*------------------------------------------------------------------------------------------------*/
@@ -1,140 +1,357 @@
-#include <array>
-#include <cstdint>
-#include <optional>
-#include <span>
-
-#include "interrupt.hpp"
-#include "io.hpp"
-#include "mech.hpp"
-#include "protocol.hpp"
-#include "thermistor.hpp"
-#include "uart.hpp"
-
-using namespace std::literals;
-
-/*------------------------------------------------------------------------------------------------*/
-
-namespace {
-
-constinit bool record{false};
-
-}
-
-/*------------------------------------------------------------------------------------------------*/
-
-auto main() -> int {
-
-    io::init();
-
-    io::paper_out();
-    io::platen_out();
-    io::monoled_1_off();
-    io::monoled_2_off();
-    io::rgb_led_set(io::LEDColour::Green);
-
-    if(const auto status = interrupt::init(); status != interrupt::Status::Ok) {
-        while(true) {
-            io::rgb_led_set(io::LEDColour::Red);
-        }
-    }
-
-    if(const auto error = uart::init(); error) {
-        while(true) {
-            io::rgb_led_set(io::LEDColour::Red);
-        }
-    }
-
-    uart::write("\r\n"sv);
-    uart::write("\r\n"sv);
-    uart::write("\r\n"sv);
-    uart::write("--------------------------------------------------\r\n"sv);
-    uart::write("Martel Print Mech Analyser\r\n"sv);
-    uart::write("--------------------------------------------------\r\n"sv);
-
-    mech::init();
-    thermistor::init();
-
-    thermistor::set_temp(25);
-
-    //////////////////////////////////////////////////
-
-    uart::write("Startup complete\r\n"sv);
-    std::optional<mech::Action> action_next{};
-
-    while(true) {
-
-        // Handle button press.
-        if(io::button_is_pressed()) {
-            io::monoled_1_on();
-            io::monoled_2_on();
-        } else {
-            io::monoled_1_off();
-            io::monoled_2_off();
-        }
-
-        // Read received bytes and process until a command is found.
-        std::optional<protocol::Command> command{};
-        while(uart::received() > 0) {
-            if(command = protocol::process_byte(uart::read()); command) {
-                break;
-            }
-        }
-
-        // Handle the command if one was found.
-        if(command) {
-            using enum protocol::Command;
-            using enum protocol::Response;
-
-            switch(command.value()) {
-                case Unrecognised: uart::write("Unrecognised command\r\n"sv); break;
-                case FrameError: uart::write("Frame error\r\n"sv); break;
-
-                case Poll: protocol::send_response(Acknowledge, std::nullopt); break;
-
-                case SetPaperIn: io::paper_in(); break;
-                case SetPaperOut: io::paper_out(); break;
-
-                case SetPlatenIn: io::platen_in(); break;
-                case SetPlatenOut: io::platen_out(); break;
-
-                case RecordingStart: {
-                    mech::clear();
-                    record = true;
-                    break;
-                }
-                case RecordingStop: record = false; break;
-            }
-        }
-
-        // Process mech events.
-        if(record) {
-            using enum protocol::Response;
-
-            if(!action_next) {
-                action_next = mech::get_next_action();
-            }
-
-            if(action_next == mech::Action::Advance) {
-                protocol::send_response(MotorAdvance, std::nullopt);
-                action_next.reset();
-
-            } else if(action_next == mech::Action::Reverse) {
-                protocol::send_response(MotorReverse, std::nullopt);
-                action_next.reset();
-
-            } else if(action_next == mech::Action::BurnLineStart) {
-                action_next.reset();
-
-            } else if(action_next == mech::Action::BurnLineStop) {
-                const auto burn_line = mech::read_burn_line();
-
-                if(!burn_line) {
-                    uart::write("Error: expected burn line but none was available.\r\n"sv);
-                } else {
-                    protocol::send_response(BurnLine, burn_line.value());
-                }
-                action_next.reset();
-            }
-        }
-    }
-}
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+
+#include "coroutine.hpp"
+#include "interrupt.hpp"
+#include "io.hpp"
+#include "mech.hpp"
+#include "protocol.hpp"
+#include "sampler.hpp"
+#include "scheduler.hpp"
+#include "script.hpp"
+#include "stream.hpp"
+#include "thermistor.hpp"
+#include "timer.hpp"
+#include "uart.hpp"
+
+using namespace std::literals;
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace {
+
+constinit bool record{false};
+
+// When the chunk of bytes being handled had all been received.
+constinit uint32_t received_at{0};
+
+// Commands parsed from the last chunk and not yet handled. One whose reply there isn't room for
+// holds up the rest, keeping replies in order.
+constinit std::array<protocol::Message, 32> pending{};
+constinit uint32_t pending_count{0};
+constinit uint32_t pending_next{0};
+
+// How far through a reply sent over several frames the command being handled has got.
+constinit uint32_t reply_next{0};
+
+auto handle(protocol::Message message) -> bool;
+
+/// @brief Parse a chunk of received bytes for each unit of budget and handle the commands in it.
+///        Replies never wait for the link. A command is held while there's no room for its reply,
+///        keeping the task ready until there is.
+auto commands_task(const uint32_t budget) -> bool {
+    for(uint32_t i = 0; i < budget; i++) {
+        if(pending_next == pending_count) {
+            std::array<uint8_t, 64> received{};
+            static_assert(pending.size() >= received.size() / 2);
+
+            const auto received_count = uart::read(received);
+            if(received_count == 0) {
+                return false;
+            }
+            received_at = uart::receive_time();
+
+            pending_count = protocol::process(std::span(received).first(received_count),
+                                              pending);
+            pending_next = 0;
+        }
+
+        while(pending_next != pending_count) {
+            if(!protocol::reply_room() || !handle(pending[pending_next])) {
+                return true;
+            }
+            pending_next++;
+        }
+    }
+
+    return uart::received() != 0;
+}
+
+/// @brief Resume the coroutines, which send an event each time, up to budget times. Gives up early
+///        when they're all held up, leaving whatever they're waiting on to signal the task again.
+auto stream_task(const uint32_t budget) -> bool {
+    if(!record) {
+        return false;
+    }
+
+    return coroutine::run(budget);
+}
+
+auto script_task([[maybe_unused]] const uint32_t budget) -> bool {
+    script::apply_temperature();
+    return false;
+}
+
+auto button_task([[maybe_unused]] const uint32_t budget) -> bool {
+    const io::Batch batch{};
+    if(io::button_is_pressed()) {
+        io::monoled_1_on();
+        io::monoled_2_on();
+    } else {
+        io::monoled_1_off();
+        io::monoled_2_off();
+    }
+    return false;
+}
+
+// Budgets are chunks of received bytes, temperature changes, events and polls respectively.
+constexpr std::array<scheduler::TaskConfig, scheduler::TASK_COUNT> TASKS{{
+    {.function = commands_task, .budget = 4, .polled = false},
+    {.function = script_task, .budget = 1, .polled = false},
+    {.function = stream_task, .budget = 32, .polled = false},
+    {.function = button_task, .budget = 1, .polled = true},
+}};
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto main() -> int {
+
+    io::init();
+
+    io::paper_out();
+    io::platen_out();
+    io::monoled_1_off();
+    io::monoled_2_off();
+    io::rgb_led_set(io::LEDColour::Green);
+
+    timer::init();
+
+    if(const auto status = interrupt::init(); status != interrupt::Status::Ok) {
+        while(true) {
+            io::rgb_led_set(io::LEDColour::Red);
+        }
+    }
+
+    if(const auto error = uart::init(); error) {
+        while(true) {
+            io::rgb_led_set(io::LEDColour::Red);
+        }
+    }
+
+    uart::write("\r\n"sv);
+    uart::write("\r\n"sv);
+    uart::write("\r\n"sv);
+    uart::write("--------------------------------------------------\r\n"sv);
+    uart::write("Martel Print Mech Analyser\r\n"sv);
+    uart::write("--------------------------------------------------\r\n"sv);
+
+    mech::init();
+    thermistor::init();
+    sampler::init();
+
+    thermistor::set_temp(25);
+
+    //////////////////////////////////////////////////
+
+    uart::write("Startup complete\r\n"sv);
+
+    scheduler::run(TASKS);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace {
+
+/// @brief Act on a command. Replies sent over several frames stop when there's no room for the
+///        next, to be picked up from reply_next when the command is handled again.
+/// @return false if the reply is unfinished.
+auto handle(const protocol::Message message) -> bool {
+    using enum protocol::Command;
+    using enum protocol::Response;
+
+    // Commands that flush the stream wait until what's batched can all be sent.
+    const auto command = message.command;
+    const bool flushes = command == RecordingStop || command == EventBlocksOn
+                      || command == EventBlocksOff || command == TimestampsOn
+                      || command == TimestampsOff;
+    if(flushes && !stream::flush_room()) {
+        return false;
+    }
+
+    switch(command) {
+        case Unrecognised: uart::write_priority("Unrecognised command\r\n"sv); break;
+        case FrameError: uart::write_priority("Frame error\r\n"sv); break;
+
+        case Poll: protocol::send_response(Acknowledge, std::nullopt); break;
+
+        case SetPaperIn: io::paper_in(); break;
+        case SetPaperOut: io::paper_out(); break;
+
+        case SetPlatenIn: io::platen_in(); break;
+        case SetPlatenOut: io::platen_out(); break;
+
+        case SetSensors: {
+            const auto sensors = static_cast<uint8_t>(message.argument);
+            {
+                // Every sensor changes in the same flush.
+                const io::Batch batch{};
+
+                if((sensors & protocol::SENSOR_PAPER) != 0) {
+                    io::paper_in();
+                } else {
+                    io::paper_out();
+                }
+
+                if((sensors & protocol::SENSOR_PLATEN) != 0) {
+                    io::platen_in();
+                } else {
+                    io::platen_out();
+                }
+            }
+
+            protocol::send_sensor_state(sensors, timer::now() - received_at);
+            break;
+        }
+
+        // Rules are counted from when recording starts.
+        case ScriptAdd: {
+            const auto rule = protocol::decode_rule(message.argument);
+            if(!rule || !script::add(rule.value())) {
+                uart::write_priority("Script rule rejected\r\n"sv);
+            }
+            break;
+        }
+        case ScriptClear: script::clear(); break;
+
+        case RecordingStart: {
+            // Lines still being sent point into their slots so wait for them before freeing them.
+            stream::clear();
+            mech::clear();
+            record = true;
+            script::start();
+            scheduler::signal(scheduler::Stream);
+            break;
+        }
+        case RecordingStop: {
+            script::stop();
+            stream::flush();
+            record = false;
+            break;
+        }
+
+        case CompressionOn: stream::set_compression(true); break;
+        case CompressionOff: stream::set_compression(false); break;
+
+        case EventBlocksOn: stream::set_batching(true); break;
+        case EventBlocksOff: stream::set_batching(false); break;
+
+        case TimestampsOn: {
+            if(!timer::AVAILABLE) {
+                uart::write_priority("Timestamps not available\r\n"sv);
+                break;
+            }
+
+            stream::set_timestamps(true);
+            break;
+        }
+        case TimestampsOff: stream::set_timestamps(false); break;
+
+        case Statistics: protocol::send_statistics(uart::queue_stats(), mech::queue_stats()); break;
+
+        case ReliableOn: stream::set_reliable(true); break;
+        case ReliableOff: stream::set_reliable(false); break;
+        case Retransmit: {
+            // However many lines are asked for, only as many go as the link has room for at once.
+            const auto first = static_cast<uint16_t>(message.argument);
+            const auto count = static_cast<uint8_t>(message.argument >> 16);
+            for(; reply_next < count; reply_next++) {
+                if(!protocol::frame_room()) {
+                    return false;
+                }
+
+                protocol::retransmit(static_cast<uint16_t>(first + reply_next));
+            }
+            break;
+        }
+
+        // Applied by the parser so the rest of the chunk is read with the new framing.
+        case CobsOn: break;
+        case CobsOff: break;
+
+        case GrantCredit: {
+            stream::grant_credit(message.argument);
+            scheduler::signal(scheduler::Stream);
+            break;
+        }
+        case CreditOff: {
+            stream::disable_credit();
+            scheduler::signal(scheduler::Stream);
+            break;
+        }
+
+        case InterruptProfile: {
+            if(!interrupt::PROFILING) {
+                uart::write_priority("Interrupt profiling not built in\r\n"sv);
+                break;
+            }
+
+            // Each interrupt in turn, then the masked windows.
+            for(; reply_next <= interrupt::COUNT; reply_next++) {
+                if(!protocol::reply_room()) {
+                    return false;
+                }
+
+                if(reply_next == interrupt::COUNT) {
+                    if(const auto profile = interrupt::masked_profile(); profile) {
+                        protocol::send_interrupt_profile(interrupt::MASKED_PROFILE,
+                                                         profile.value());
+                    }
+                } else {
+                    const auto source = static_cast<interrupt::Interrupt>(reply_next);
+                    if(const auto profile = interrupt::profile(source); profile) {
+                        protocol::send_interrupt_profile(source, profile.value());
+                    }
+                }
+            }
+            break;
+        }
+
+        case TaskStatistics: {
+            for(; reply_next < scheduler::TASK_COUNT; reply_next++) {
+                if(!protocol::reply_room()) {
+                    return false;
+                }
+
+                const auto task = static_cast<scheduler::Task>(reply_next);
+                if(const auto stats = scheduler::stats(task); stats) {
+                    protocol::send_task_stats(task, stats.value());
+                }
+            }
+            break;
+        }
+
+        case PcHistogram: {
+            if(!sampler::AVAILABLE) {
+                uart::write_priority("PC sampling not built in\r\n"sv);
+                break;
+            }
+
+            // Each dump covers the time since the last. Samples keep being taken while it's
+            // sent, so a bucket's count is as of when its frame went.
+            const auto buckets = sampler::histogram();
+            while(reply_next < buckets.size()) {
+                if(!protocol::frame_room()) {
+                    return false;
+                }
+
+                reply_next = protocol::send_pc_histogram(sampler::low_pc(),
+                                                         sampler::bucket_size(),
+                                                         buckets,
+                                                         reply_next);
+            }
+            sampler::clear();
+            break;
+        }
+    }
+
+    reply_next = 0;
+    return true;
+}
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
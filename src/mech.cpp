@@ -6,6 +6,7 @@
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 #include <array>
+#include <bit>
 #include <cstdint>
 
 #include "xllfifo.h"
@@ -13,6 +14,10 @@
 
 #include "interrupt.hpp"
 #include "mech.hpp"
+#include "ring_buffer.hpp"
+#include "scheduler.hpp"
+#include "script.hpp"
+#include "timer.hpp"
 
 /*------------------------------------------------------------------------------------------------*/
 
@@ -20,17 +25,30 @@ namespace {
 
 constexpr uint32_t BURN_BUFFER_ID = XPAR_BURN_BUFFER_DEVICE_ID;
 
+// BurnLine::bytes() views the FIFO words as bytes, lowest byte first.
+static_assert(std::endian::native == std::endian::little);
+
 XLlFifo burn_buffer;
 
-auto action_buffer = std::array<volatile mech::Action, 1024>{};
-volatile uint32_t action_buffer_in_ptr = 0;
-volatile uint32_t action_buffer_out_ptr = 0;
-volatile uint32_t action_buffer_count = 0;
+constinit RingBuffer<mech::Event, 1024> action_buffer{};
+
+// Lines are drained from the burn buffer by its ISR into preallocated slots so a slow UART doesn't
+// back up into the FIFO. The sequence number keeps counting when the slots are full so dropped
+// lines show up as gaps.
+constinit RingBuffer<mech::BurnLine, 32> line_buffer{};
+constinit uint32_t line_sequence{0};
+
+// Lines handed out by read_burn_line() but not yet released. They stay in their slots so they can
+// be sent from there.
+constinit uint32_t lines_read{0};
 
-void motor_advance_isr(void* CallbackRef);
-void motor_reverse_isr(void* CallbackRef);
-void head_active_start_isr(void* CallbackRef);
-void head_active_end_isr(void* CallbackRef);
+// The tick interrupts fire on every step so they're vectored straight to their handlers.
+[[gnu::fast_interrupt]] void motor_advance_isr();
+[[gnu::fast_interrupt]] void motor_reverse_isr();
+[[gnu::fast_interrupt]] void head_active_start_isr();
+[[gnu::fast_interrupt]] void head_active_end_isr();
+
+void burn_buffer_isr(void* CallbackRef);
 
 }
 
@@ -44,101 +62,123 @@ auto mech::init() -> void {
     XLlFifo_Status(&burn_buffer);
     XLlFifo_IntClear(&burn_buffer, 0xFFFFFFFF);
     XLlFifo_Status(&burn_buffer);
+    XLlFifo_IntEnable(&burn_buffer, XLLF_INT_RC_MASK);
 
-    interrupt::enable(interrupt::MotorAdvance, (XInterruptHandler)motor_advance_isr, nullptr);
-    interrupt::enable(interrupt::MotorReverse, (XInterruptHandler)motor_reverse_isr, nullptr);
-    interrupt::enable(interrupt::HeadActiveStart,
-                      (XInterruptHandler)head_active_start_isr,
-                      nullptr);
-    interrupt::enable(interrupt::HeadActiveEnd, (XInterruptHandler)head_active_end_isr, nullptr);
+    interrupt::enable_fast(interrupt::MotorAdvance, motor_advance_isr);
+    interrupt::enable_fast(interrupt::MotorReverse, motor_reverse_isr);
+    interrupt::enable_fast(interrupt::HeadActiveStart, head_active_start_isr);
+    interrupt::enable_fast(interrupt::HeadActiveEnd, head_active_end_isr);
+    interrupt::enable(interrupt::BurnBuffer, burn_buffer_isr, nullptr);
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
 auto mech::clear() -> void {
-    const uint32_t words = XLlFifo_iRxGetLen(&burn_buffer);
-    if(words < HEAD_WORDS) {
-        return;
-    }
+    line_buffer.clear();
+    lines_read = 0;
+    action_buffer.clear();
+}
 
-    while(XLlFifo_iRxGetLen(&burn_buffer) > 0) {
-        XLlFifo_RxGetWord(&burn_buffer);
-    }
+/*------------------------------------------------------------------------------------------------*/
 
-    action_buffer_in_ptr = 0;
-    action_buffer_out_ptr = 0;
-    action_buffer_count = 0;
+auto mech::get_next_event() -> std::optional<Event> {
+    return action_buffer.pop();
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
-auto mech::get_next_action() -> std::optional<Action> {
-    if(action_buffer_out_ptr == action_buffer_in_ptr) {
-        return std::nullopt;
+/// @brief Get the next line without copying it out of its slot. The slot isn't reused until the
+///        line is released, oldest first, with release_burn_line().
+/// @return nullptr if no line is available.
+auto mech::read_burn_line() -> const BurnLine* {
+    if(lines_read == line_buffer.size()) {
+        return nullptr;
     }
 
-    const auto next_action = action_buffer[action_buffer_out_ptr];
-    action_buffer_out_ptr = (action_buffer_out_ptr + 1) % action_buffer.size();
-    action_buffer_count--;
-
-    return next_action;
+    return &line_buffer.at(lines_read++);
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
-auto mech::read_burn_line() -> std::optional<std::array<uint8_t, HEAD_BYTES>> {
-    const uint32_t words = XLlFifo_iRxGetLen(&burn_buffer) / 4;
-    if(words < HEAD_WORDS) {
-        return std::nullopt;
+auto mech::release_burn_line() -> void {
+    if(lines_read == 0) {
+        return;
     }
 
-    std::array<uint8_t, HEAD_BYTES> burn_line{};
-    for(uint32_t i = 0; i < HEAD_BYTES; i += 4) {
-        const auto word = XLlFifo_RxGetWord(&burn_buffer);
+    line_buffer.consume(1);
+    lines_read--;
+}
 
-        burn_line[i + 0] = static_cast<uint8_t>((word >> 0) & 0xFF);
-        burn_line[i + 1] = static_cast<uint8_t>((word >> 8) & 0xFF);
-        burn_line[i + 2] = static_cast<uint8_t>((word >> 16) & 0xFF);
-        burn_line[i + 3] = static_cast<uint8_t>((word >> 24) & 0xFF);
-    }
+/*------------------------------------------------------------------------------------------------*/
 
-    return burn_line;
+auto mech::queue_stats() -> Queues {
+    return Queues{.events = action_buffer.stats(), .lines = line_buffer.stats()};
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
 namespace {
 
-void motor_advance_isr([[maybe_unused]] void* CallbackRef) {
-    interrupt::acknowledge(interrupt::MotorAdvance);
-
-    action_buffer[action_buffer_in_ptr] = mech::Action::Advance;
-    action_buffer_in_ptr = (action_buffer_in_ptr + 1) % action_buffer.size();
-    action_buffer_count++;
+void motor_advance_isr() {
+    const interrupt::ProfileScope profile{interrupt::MotorAdvance};
+    const auto time = timer::now();
+    script::step();
+    action_buffer.push(mech::Event{.action = mech::Action::Advance, .time = time});
+    scheduler::signal(scheduler::Stream);
 }
 
-void motor_reverse_isr([[maybe_unused]] void* CallbackRef) {
-    interrupt::acknowledge(interrupt::MotorReverse);
-
-    action_buffer[action_buffer_in_ptr] = mech::Action::Reverse;
-    action_buffer_in_ptr = (action_buffer_in_ptr + 1) % action_buffer.size();
-    action_buffer_count++;
+void motor_reverse_isr() {
+    const interrupt::ProfileScope profile{interrupt::MotorReverse};
+    const auto time = timer::now();
+    action_buffer.push(mech::Event{.action = mech::Action::Reverse, .time = time});
+    scheduler::signal(scheduler::Stream);
 }
 
-void head_active_start_isr([[maybe_unused]] void* CallbackRef) {
-    interrupt::acknowledge(interrupt::HeadActiveStart);
+void head_active_start_isr() {
+    const interrupt::ProfileScope profile{interrupt::HeadActiveStart};
+    const auto time = timer::now();
+    action_buffer.push(mech::Event{.action = mech::Action::BurnLineStart, .time = time});
+    scheduler::signal(scheduler::Stream);
+}
 
-    action_buffer[action_buffer_in_ptr] = mech::Action::BurnLineStart;
-    action_buffer_in_ptr = (action_buffer_in_ptr + 1) % action_buffer.size();
-    action_buffer_count++;
+void head_active_end_isr() {
+    const interrupt::ProfileScope profile{interrupt::HeadActiveEnd};
+    const auto time = timer::now();
+    script::line();
+    action_buffer.push(mech::Event{.action = mech::Action::BurnLineStop, .time = time});
+    scheduler::signal(scheduler::Stream);
 }
 
-void head_active_end_isr([[maybe_unused]] void* CallbackRef) {
-    interrupt::acknowledge(interrupt::HeadActiveEnd);
+void burn_buffer_isr([[maybe_unused]] void* CallbackRef) {
+    XLlFifo_IntClear(&burn_buffer, XLLF_INT_RC_MASK);
+    interrupt::acknowledge(interrupt::BurnBuffer);
+
+    // Drain every complete line, straight into a free slot where there is one.
+    while(XLlFifo_iRxOccupancy(&burn_buffer) != 0) {
+        const uint32_t words = XLlFifo_iRxGetLen(&burn_buffer) / sizeof(uint32_t);
+        if(words == 0) {
+            break;
+        }
+
+        const auto slot = line_buffer.write_span();
+        if(words != mech::HEAD_WORDS || slot.empty()) {
+            line_buffer.record_drop();
+            for(uint32_t i = 0; i < words; i++) {
+                XLlFifo_RxGetWord(&burn_buffer);
+            }
+        } else {
+            auto& line = slot.front();
+            line.sequence = line_sequence;
+            for(auto& word : line.words) {
+                word = XLlFifo_RxGetWord(&burn_buffer);
+            }
+            line_buffer.commit(1);
+        }
+
+        line_sequence++;
+    }
 
-    action_buffer[action_buffer_in_ptr] = mech::Action::BurnLineStop;
-    action_buffer_in_ptr = (action_buffer_in_ptr + 1) % action_buffer.size();
-    action_buffer_count++;
+    scheduler::signal(scheduler::Stream);
 }
 
 }
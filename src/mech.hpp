@@ -9,6 +9,9 @@
 #include <array>
 #include <cstdint>
 #include <optional>
+#include <span>
+
+#include "ring_buffer.hpp"
 
 /*------------------------------------------------------------------------------------------------*/
 
@@ -25,6 +28,31 @@ constexpr uint32_t HEAD_WIDTH = 384;
 constexpr uint32_t HEAD_BYTES = (HEAD_WIDTH / 8);
 constexpr uint32_t HEAD_WORDS = (HEAD_BYTES / 4);
 
+/// @brief An action along with the timer::now() timestamp taken on entry to its ISR.
+struct Event {
+    Action action;
+    uint32_t time;
+};
+
+/// @brief A burn line as read from the burn buffer. Lines are numbered in the order they're
+///        received so gaps show where lines were dropped.
+struct BurnLine {
+    uint32_t sequence;
+    std::array<uint32_t, HEAD_WORDS> words;
+
+    /// @brief Line data in the order it was shifted into the head.
+    auto bytes() const -> std::span<const uint8_t, HEAD_BYTES> {
+        return std::span<const uint8_t, HEAD_BYTES>(reinterpret_cast<const uint8_t*>(words.data()),
+                                                    HEAD_BYTES);
+    }
+};
+
+/// @brief Usage of the event buffer and the burn line slots.
+struct Queues {
+    QueueStats events;
+    QueueStats lines;
+};
+
 }
 
 /*------------------------------------------------------------------------------------------------*/
@@ -35,9 +63,13 @@ auto init() -> void;
 
 auto clear() -> void;
 
-auto get_next_action() -> std::optional<Action>;
+auto get_next_event() -> std::optional<Event>;
+
+auto read_burn_line() -> const BurnLine*;
+
+auto release_burn_line() -> void;
 
-auto read_burn_line() -> std::optional<std::array<uint8_t, HEAD_BYTES>>;
+auto queue_stats() -> Queues;
 
 }
 
@@ -5,20 +5,29 @@
 /// @brief   Module for enccoding and decoding data.
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+#include <algorithm>
 #include <array>
+#include <span>
 
+#include "mech.hpp"
 #include "protocol.hpp"
+#include "timer.hpp"
 #include "uart.hpp"
 
 /*------------------------------------------------------------------------------------------------*/
-// types
+// private types
 /*------------------------------------------------------------------------------------------------*/
 
-enum class State {
+namespace {
+
+enum class State : uint8_t {
     Idle,
     Processing,
+    Escaped,
 };
 
+}
+
 /*------------------------------------------------------------------------------------------------*/
 // private variables
 /*------------------------------------------------------------------------------------------------*/
@@ -29,13 +38,147 @@ constexpr uint8_t FRAME_START = 0x02;
 constexpr uint8_t FRAME_END = 0x03;
 constexpr uint8_t ESCAPE = 0x1B;
 
-constinit State state = State::Idle;
+constexpr std::array<uint8_t, 2> BURN_LINE_HEADER{FRAME_START, 'U'};
+constexpr std::array<uint8_t, 3> FRAME_TRAILER{FRAME_END, '\r', '\n'};
+
+// Classifies every byte value as 1 if it must be escaped within a frame, 0 if not. Indexed lookups
+// let the encoder escape without branching on each byte, and the parser pass over ordinary bytes
+// with a single test.
+constexpr auto ESCAPE_TABLE = [] {
+    std::array<uint8_t, 256> table{};
+    table[FRAME_START] = 1;
+    table[FRAME_END] = 1;
+    table[ESCAPE] = 1;
+    return table;
+}();
+
+// Frames are built whole in frame_buffer so each is queued with a single write, all or nothing.
+using protocol::FRAME_MAX;
+using protocol::FRAME_PAYLOAD_MAX;
+
+static_assert(FRAME_MAX == 2 + (FRAME_PAYLOAD_MAX * 2) + FRAME_TRAILER.size());
+static_assert(FRAME_MAX >= 2 + (1 + FRAME_PAYLOAD_MAX) + ((1 + FRAME_PAYLOAD_MAX) / 254) + 1,
+              "A COBS frame must fit too");
+
+constinit std::array<uint8_t, FRAME_MAX> frame_buffer{};
 
-constinit bool escape_next = false;
+constinit protocol::Framing framing = protocol::Framing::Escaped;
+
+// COBS frames are delimited by zero bytes. One is sent either side of each frame so anything
+// written between frames is discarded by the host as a bad frame rather than corrupting the next.
+constexpr uint8_t COBS_DELIMITER = 0x00;
+constexpr uint8_t COBS_BLOCK_MAX = 0xFF;
+
+constinit State state = State::Idle;
 
 constinit std::array<uint8_t, 64> cmd_buffer{};
 constinit uint32_t cmd_buffer_in_ptr{};
 
+/// @brief A command and the bytes of argument it takes. Arguments longer than 4 bytes count as 4.
+struct Opcode {
+    protocol::Command command;
+    uint8_t min_arguments;
+    uint8_t max_arguments;
+};
+
+// Indexed by opcode, so decoding a command is one lookup rather than a switch.
+constexpr auto OPCODES = [] {
+    using enum protocol::Command;
+
+    std::array<Opcode, 256> table{};
+    table.fill(Opcode{.command = Unrecognised, .min_arguments = 0, .max_arguments = 4});
+
+    const auto set = [&table](const uint8_t opcode,
+                              const protocol::Command command,
+                              const uint8_t min_arguments = 0,
+                              const uint8_t max_arguments = 4) {
+        table[opcode] = Opcode{.command = command,
+                               .min_arguments = min_arguments,
+                               .max_arguments = max_arguments};
+    };
+
+    set('P', Poll);
+
+    set('A', SetPaperIn);
+    set('a', SetPaperOut);
+
+    set('L', SetPlatenIn);
+    set('l', SetPlatenOut);
+
+    set('R', RecordingStart);
+    set('r', RecordingStop);
+
+    set('C', CompressionOn);
+    set('c', CompressionOff);
+
+    set('E', EventBlocksOn);
+    set('e', EventBlocksOff);
+
+    set('T', TimestampsOn);
+    set('t', TimestampsOff);
+
+    set('S', Statistics);
+
+    set('Q', ReliableOn);
+    set('q', ReliableOff);
+    set('N', Retransmit, 3, 3);
+
+    set('O', CobsOn);
+    set('o', CobsOff);
+
+    set('G', GrantCredit, 1);
+    set('g', CreditOff);
+
+    set('I', InterruptProfile);
+    set('H', PcHistogram);
+    set('K', TaskStatistics);
+    set('M', SetSensors, 1);
+    set('X', ScriptAdd, 4);
+    set('x', ScriptClear);
+
+    return table;
+}();
+
+// Run length encoding control bytes. A control byte with the run flag set is followed by a single
+// byte to be repeated, otherwise it's followed by that many literal bytes. Both store length - 1.
+constexpr uint8_t RUN_FLAG = 0x80;
+constexpr uint32_t MAX_RUN = 128;
+constexpr uint32_t MIN_RUN = 3;
+
+// The last burn line sent, used as the reference for the next compressed line.
+constinit std::array<uint8_t, mech::HEAD_BYTES> previous_line{};
+
+// Varints are little endian base 128, the top bit of each byte flagging that another follows.
+constexpr uint32_t VARINT_MAX_BYTES = 5;
+
+// CRC-16/CCITT-FALSE, one table lookup per byte.
+constexpr auto CRC_TABLE = [] {
+    std::array<uint16_t, 256> table{};
+    for(uint32_t i = 0; i < table.size(); i++) {
+        auto crc = static_cast<uint16_t>(i << 8);
+        for(uint32_t bit = 0; bit < 8; bit++) {
+            crc = static_cast<uint16_t>((crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1);
+        }
+        table[i] = crc;
+    }
+    return table;
+}();
+
+// In reliable mode each line is sent with a link sequence number and a CRC. The encoded payloads of
+// the last RETRANSMIT_LINES lines are kept, indexed by sequence number, so the host can ask for
+// any it missed.
+constexpr uint32_t RETRANSMIT_LINES = 16;
+constexpr uint32_t RELIABLE_PAYLOAD_MAX = 2 + 1 + (mech::HEAD_BYTES * 2) + 2;
+
+struct SentLine {
+    uint16_t sequence;
+    uint8_t size;
+    std::array<uint8_t, RELIABLE_PAYLOAD_MAX> payload;
+};
+
+constinit std::array<SentLine, RETRANSMIT_LINES> sent_lines{};
+constinit uint16_t reliable_sequence{0};
+
 }
 
 /*------------------------------------------------------------------------------------------------*/
@@ -44,7 +187,35 @@ constinit uint32_t cmd_buffer_in_ptr{};
 
 namespace {
 
-auto process_command() -> std::optional<protocol::Command>;
+auto process_command(uint32_t size) -> protocol::Message;
+
+auto escaped_size(std::span<const uint8_t> data) -> uint32_t;
+
+auto write_frame(uint8_t opcode, std::span<const uint8_t> payload, bool priority = false) -> bool;
+
+// Kept out of line so the scan loops stay tight around the bytes that are only stored.
+[[gnu::noinline]] auto emit(protocol::Message message,
+                            std::span<protocol::Message> messages,
+                            uint32_t& found) -> bool;
+auto scan_escaped(std::span<const uint8_t>& data,
+                  std::span<protocol::Message> messages,
+                  uint32_t found) -> uint32_t;
+auto scan_cobs(std::span<const uint8_t>& data,
+               std::span<protocol::Message> messages,
+               uint32_t found) -> uint32_t;
+
+auto cobs_decode(std::span<uint8_t> data) -> std::optional<uint32_t>;
+
+auto compress_line(std::span<const uint8_t> line, std::span<uint8_t> output) -> uint32_t;
+auto keep_line(std::span<const uint8_t> line) -> void;
+
+auto write_varint(uint32_t value, std::span<uint8_t> output) -> uint32_t;
+
+auto event_code(mech::Action action) -> uint8_t;
+
+auto crc16(std::span<const uint8_t> data) -> uint16_t;
+
+auto write_le(uint64_t value, uint32_t bytes, std::span<uint8_t> output) -> uint32_t;
 
 }
 
@@ -52,36 +223,66 @@ auto process_command() -> std::optional<protocol::Command>;
 // public functions
 /*------------------------------------------------------------------------------------------------*/
 
-auto protocol::process_byte(uint8_t byte) -> std::optional<Command> {
-
-    if(state == State::Idle) {
-        if(byte == FRAME_START) {
-            cmd_buffer_in_ptr = 0;
-            state = State::Processing;
-        }
-        return std::nullopt;
+/// @brief Scan a chunk of received data for commands. Frames may be split across calls.
+/// @param messages Filled with the commands found, in order. Commands that don't fit are dropped,
+///                 which can't happen if it's at least half the size of data as the shortest
+///                 frame is two bytes.
+/// @return Number of commands found.
+auto protocol::process(std::span<const uint8_t> data, std::span<Message> messages) -> uint32_t {
+    uint32_t found = 0;
+
+    // A scan only stops early for a command that changes the framing, so the rest of data is read
+    // with the new one.
+    while(!data.empty()) {
+        found = (framing == Framing::Cobs) ? scan_cobs(data, messages, found)
+                                           : scan_escaped(data, messages, found);
     }
 
-    // state == Processing.
-    if(byte == FRAME_START && !escape_next) {
-        state = State::Idle;
-        return Command::FrameError;
-    }
+    return found;
+}
 
-    if(byte == FRAME_END && !escape_next) {
-        state = State::Idle;
-        return process_command();
-    }
+/*------------------------------------------------------------------------------------------------*/
+
+auto protocol::set_framing(const Framing mode) -> void {
+    framing = mode;
+
+    // COBS frames start as soon as the previous one's delimiter has been seen.
+    state = (mode == Framing::Cobs) ? State::Processing : State::Idle;
+    cmd_buffer_in_ptr = 0;
+}
+
+/*------------------------------------------------------------------------------------------------*/
 
-    if(byte == ESCAPE && !escape_next) {
-        escape_next = true;
+/// @brief Unpack a script rule. The count is in bits 0-19, the action in 20-22, the trigger in 23
+///        (0 for steps, 1 for lines) and the value, signed, in 24-31.
+/// @return std::nullopt if the action isn't one.
+auto protocol::decode_rule(const uint32_t argument) -> std::optional<script::Rule> {
+    const auto action = static_cast<uint8_t>((argument >> 20) & 0b111);
+    if(action > static_cast<uint8_t>(script::Action::SetTemperature)) {
         return std::nullopt;
     }
 
-    cmd_buffer[cmd_buffer_in_ptr++] = byte;
-    escape_next = false;
+    return script::Rule{
+        .trigger = ((argument & (1U << 23)) != 0) ? script::Trigger::Lines : script::Trigger::Steps,
+        .action = static_cast<script::Action>(action),
+        .value = static_cast<int8_t>(argument >> 24),
+        .count = argument & 0xFFFFF,
+    };
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Whether a command's control frame reply can be queued without waiting for the link.
+///        Commands are held until it can, as write_frame() drops rather than waits.
+auto protocol::reply_room() -> bool {
+    return uart::free_priority() >= CONTROL_FRAME_MAX;
+}
+
+/*------------------------------------------------------------------------------------------------*/
 
-    return std::nullopt;
+/// @brief Whether a bulk frame of any size can be queued without waiting for the link.
+auto protocol::frame_room() -> bool {
+    return uart::free() >= FRAME_MAX;
 }
 
 /*------------------------------------------------------------------------------------------------*/
@@ -89,61 +290,679 @@ auto protocol::process_byte(uint8_t byte) -> std::optional<Command> {
 auto protocol::send_response(Response response, std::optional<const std::span<const uint8_t>> data)
     -> void {
     if(response == Response::Acknowledge) {
-        // while(uart::free() < 5);
-        uart::write(std::array<uint8_t, 5>{FRAME_START, 0x06, FRAME_END, '\r', '\n'});
+        write_frame(0x06, {}, true);
         return;
     }
 
     if(response == Response::MotorAdvance) {
-        // while(uart::free() < 5);
-        uart::write(std::array<uint8_t, 5>{FRAME_START, 'F', FRAME_END, '\r', '\n'});
+        write_frame('F', {});
         return;
     }
 
     if(response == Response::MotorReverse) {
-        // while(uart::free() < 5);
-        uart::write(std::array<uint8_t, 5>{FRAME_START, 'B', FRAME_END, '\r', '\n'});
+        write_frame('B', {});
         return;
     }
 
+    // Fall back to an uncompressed line if it can't be delta encoded against the previous one.
+    if(response == Response::BurnLineCompressed && data
+       && data.value().size() != previous_line.size()) {
+        response = Response::BurnLine;
+    }
+
     if(response == Response::BurnLine && data) {
-        // while(uart::free() < (data.value().size() + 5));
-        uart::write(std::array<uint8_t, 2>{FRAME_START, 'U'});
-
-        for(const auto byte : data.value()) {
-            if(byte == FRAME_START || byte == FRAME_END || byte == ESCAPE) {
-                uart::write(std::array{ESCAPE, byte});
-            } else {
-                uart::write(byte);
-            }
-        }
+        keep_line(data.value());
+        write_frame('U', data.value());
+        return;
+    }
+
+    if(response == Response::BurnLineCompressed && data) {
+        std::array<uint8_t, mech::HEAD_BYTES * 2> compressed{};
+        const auto size = compress_line(data.value(), compressed);
 
-        uart::write(std::array<uint8_t, 3>{FRAME_END, '\r', '\n'});
+        write_frame('Z', std::span(compressed).first(size));
         return;
     }
 }
 
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Send a raw burn line. Where nothing needs escaping it's sent straight from line's memory
+///        rather than being copied, so line must stay valid until the returned ticket is sent.
+auto protocol::send_burn_line(std::span<const uint8_t> line) -> uart::Ticket {
+    if(framing == Framing::Escaped && escaped_size(line) == line.size()) {
+        const std::array<std::span<const uint8_t>, 3> segments{BURN_LINE_HEADER,
+                                                               line,
+                                                               FRAME_TRAILER};
+
+        if(const auto ticket = uart::write(segments); ticket) {
+            keep_line(line);
+            return ticket.value();
+        }
+    }
+
+    send_response(Response::BurnLine, line);
+    return uart::ticket();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto protocol::send_event_block(std::span<const EventRun> runs) -> void {
+    // Each run is sent as the event's opcode followed by its count.
+    std::array<uint8_t, EVENT_BLOCK_RUNS * 2> payload{};
+    uint32_t size = 0;
+
+    for(const auto& run : runs.first(std::min<size_t>(runs.size(), EVENT_BLOCK_RUNS))) {
+        payload[size++] = (run.event == Response::MotorReverse) ? 'B' : 'F';
+        payload[size++] = run.count;
+    }
+
+    write_frame('E', std::span(payload).first(size));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto protocol::send_timed_events(std::span<const mech::Event> events, uint32_t reference)
+    -> void {
+    // Each event is sent as its code followed by the cycles since the one before it as a varint.
+    // The first is relative to reference. The host rebuilds absolute times with a running sum.
+    std::array<uint8_t, TIMED_BLOCK_EVENTS * (1 + VARINT_MAX_BYTES)> payload{};
+    uint32_t size = 0;
+
+    for(const auto& event : events.first(std::min<size_t>(events.size(), TIMED_BLOCK_EVENTS))) {
+        payload[size++] = event_code(event.action);
+        size += write_varint(event.time - reference, std::span(payload).subspan(size));
+        reference = event.time;
+    }
+
+    write_frame('T', std::span(payload).first(size));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Confirm the sensors now set and how many cycles after the command arrived they changed.
+///        Without a timer there's no latency to give so the payload is just the sensors.
+auto protocol::send_sensor_state(const uint8_t sensors, const uint32_t latency) -> void {
+    std::array<uint8_t, 1 + 4> payload{};
+    uint32_t size = 0;
+
+    payload[size++] = sensors;
+    if constexpr(timer::AVAILABLE) {
+        size += write_le(latency, 4, std::span(payload).subspan(size));
+    }
+
+    write_frame('M', std::span(payload).first(size), true);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Send the usage of every queue. Each is its high water mark then its drop count, both 32
+///        bit little endian, in this order: UART transmit buffer, UART transmit segments, UART
+///        receive buffer, mech event buffer, burn line slots, UART control transmit buffer.
+auto protocol::send_statistics(const uart::Queues& uart_queues, const mech::Queues& mech_queues)
+    -> void {
+    const std::array queues{uart_queues.tx_buffer,
+                            uart_queues.tx_segments,
+                            uart_queues.rx_buffer,
+                            mech_queues.events,
+                            mech_queues.lines,
+                            uart_queues.tx_control};
+
+    std::array<uint8_t, queues.size() * 8> payload{};
+    uint32_t size = 0;
+    for(const auto& queue : queues) {
+        size += write_le(queue.high_water, 4, std::span(payload).subspan(size));
+        size += write_le(queue.dropped, 4, std::span(payload).subspan(size));
+    }
+
+    write_frame('S', payload, true);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Send an interrupt's profile. The payload is its number, count, total cycles, max cycles
+///        then each latency bucket's count, all little endian. The total is 64 bit, the rest are
+///        32 bit apart from the 8 bit number. interrupt::MASKED_PROFILE numbers the windows
+///        interrupts were held off.
+auto protocol::send_interrupt_profile(const uint8_t source, const interrupt::Profile& profile)
+    -> void {
+    std::array<uint8_t, CONTROL_PAYLOAD_MAX> payload{};
+    uint32_t size = 0;
+
+    payload[size++] = source;
+    size += write_le(profile.count, 4, std::span(payload).subspan(size));
+    size += write_le(profile.total_cycles, 8, std::span(payload).subspan(size));
+    size += write_le(profile.max_cycles, 4, std::span(payload).subspan(size));
+    for(const auto count : profile.latency) {
+        size += write_le(count, 4, std::span(payload).subspan(size));
+    }
+
+    write_frame('I', std::span(payload).first(size), true);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Send a scheduler task's run count, how many runs used their whole budget, then its total
+///        and longest run time in cycles. Without a timer the times are left off.
+auto protocol::send_task_stats(const scheduler::Task task, const scheduler::TaskStats& stats)
+    -> void {
+    std::array<uint8_t, 1 + 4 + 4 + 8 + 4> payload{};
+    uint32_t size = 0;
+
+    payload[size++] = task;
+    size += write_le(stats.runs, 4, std::span(payload).subspan(size));
+    size += write_le(stats.exhausted, 4, std::span(payload).subspan(size));
+    if constexpr(timer::AVAILABLE) {
+        size += write_le(stats.total_cycles, 8, std::span(payload).subspan(size));
+        size += write_le(stats.max_cycles, 4, std::span(payload).subspan(size));
+    }
+
+    write_frame('K', std::span(payload).first(size), true);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Send one frame of the PC sample histogram, starting from bucket first. Each payload is
+///        the lowest address sampled, the bytes per bucket, the total number of buckets, the index
+///        of the frame's first bucket then its bucket counts. Addresses and sizes are 32 bit, the
+///        rest 16 bit, all little endian.
+/// @return The first bucket of the next frame, buckets.size() once they've all been sent.
+auto protocol::send_pc_histogram(const uint32_t low_pc,
+                                 const uint32_t bucket_size,
+                                 std::span<const uint16_t> buckets,
+                                 const uint32_t first) -> uint32_t {
+    constexpr uint32_t HEADER_BYTES = 4 + 4 + 2 + 2;
+    constexpr uint32_t FRAME_BUCKETS = (FRAME_PAYLOAD_MAX - HEADER_BYTES) / 2;
+
+    const auto remaining = buckets.size() - first;
+    const auto counts = buckets.subspan(first, std::min<size_t>(remaining, FRAME_BUCKETS));
+
+    std::array<uint8_t, FRAME_PAYLOAD_MAX> payload{};
+    uint32_t size = 0;
+
+    size += write_le(low_pc, 4, std::span(payload).subspan(size));
+    size += write_le(bucket_size, 4, std::span(payload).subspan(size));
+    size += write_le(buckets.size(), 2, std::span(payload).subspan(size));
+    size += write_le(first, 2, std::span(payload).subspan(size));
+    for(const auto count : counts) {
+        size += write_le(count, 2, std::span(payload).subspan(size));
+    }
+
+    write_frame('H', std::span(payload).first(size));
+    return first + static_cast<uint32_t>(counts.size());
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Send a line in a reliable frame and keep it for retransmission. The payload is the link
+///        sequence number, the line's usual opcode and payload, then a CRC of everything before it.
+///        Sequence numbers and CRCs are 16 bit little endian.
+auto protocol::send_reliable_line(std::span<const uint8_t> line, const bool compressed) -> void {
+    auto& sent = sent_lines[reliable_sequence % RETRANSMIT_LINES];
+    auto& payload = sent.payload;
+
+    payload[0] = static_cast<uint8_t>(reliable_sequence);
+    payload[1] = static_cast<uint8_t>(reliable_sequence >> 8);
+    uint32_t size = 3;
+
+    if(compressed && line.size() == previous_line.size()) {
+        payload[2] = 'Z';
+        size += compress_line(line, std::span(payload).subspan(size));
+    } else {
+        line = line.first(std::min<size_t>(line.size(), mech::HEAD_BYTES));
+        keep_line(line);
+        payload[2] = 'U';
+        std::copy(line.begin(), line.end(), payload.begin() + size);
+        size += static_cast<uint32_t>(line.size());
+    }
+
+    const auto crc = crc16(std::span(payload).first(size));
+    payload[size++] = static_cast<uint8_t>(crc);
+    payload[size++] = static_cast<uint8_t>(crc >> 8);
+
+    sent.sequence = reliable_sequence++;
+    sent.size = static_cast<uint8_t>(size);
+
+    write_frame('V', std::span(payload).first(size));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Resend a line by its sequence number. A line no longer held is answered with a frame
+///        carrying just its sequence number. One frame a call, so the caller can wait for room
+///        between them.
+auto protocol::retransmit(const uint16_t sequence) -> void {
+    const auto& sent = sent_lines[sequence % RETRANSMIT_LINES];
+
+    if(sent.size != 0 && sent.sequence == sequence) {
+        write_frame('V', std::span(sent.payload).first(sent.size));
+    } else {
+        const std::array<uint8_t, 2> missing{static_cast<uint8_t>(sequence),
+                                             static_cast<uint8_t>(sequence >> 8)};
+        write_frame('v', missing);
+    }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto protocol::clear() -> void {
+    previous_line.fill(0);
+
+    for(auto& sent : sent_lines) {
+        sent.size = 0;
+    }
+    reliable_sequence = 0;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Escape data into output in a single pass. An escape byte is always written but only kept
+///        when the table says the byte after it needs one.
+/// @param output Must hold at least escaped_size(data) bytes, twice data's size at most.
+/// @return Number of bytes written to output.
+auto protocol::escape(std::span<const uint8_t> data, std::span<uint8_t> output) -> uint32_t {
+    uint32_t size = 0;
+    for(const auto byte : data) {
+        output[size] = ESCAPE;
+        size += ESCAPE_TABLE[byte];
+        output[size++] = byte;
+    }
+    return size;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Consistent overhead byte stuffing. Each zero is replaced by the distance to the next,
+///        with a code byte every 254 bytes of non-zero data, so output holds no zeros and is at
+///        most one byte per 254 longer than data, plus one.
+/// @param output Must hold at least data.size() + (data.size() / 254) + 1 bytes.
+/// @return Number of bytes written to output.
+auto protocol::cobs_encode(std::span<const uint8_t> data, std::span<uint8_t> output) -> uint32_t {
+    uint32_t code_index = 0;
+    uint32_t out = 1;
+    uint8_t code = 1;
+
+    for(const auto byte : data) {
+        if(byte != 0) {
+            output[out++] = byte;
+            code++;
+        }
+
+        if(byte == 0 || code == COBS_BLOCK_MAX) {
+            output[code_index] = code;
+            code_index = out++;
+            code = 1;
+        }
+    }
+
+    output[code_index] = code;
+    return out;
+}
+
 /*------------------------------------------------------------------------------------------------*/
 // private functions
 /*------------------------------------------------------------------------------------------------*/
 
 namespace {
 
-auto process_command() -> std::optional<protocol::Command> {
-    switch(cmd_buffer.front()) {
-        case 'P': return protocol::Command::Poll;
+/// @brief Decode the command collected in cmd_buffer, its opcode then up to 4 bytes of little
+///        endian argument.
+auto process_command(const uint32_t size) -> protocol::Message {
+    if(size == 0) {
+        return protocol::Message{.command = protocol::Command::Unrecognised, .argument = 0};
+    }
+
+    // All 4 bytes are read and any past the end masked off, so there's no loop to mispredict.
+    const auto argument_bytes = std::min<uint32_t>(size - 1, sizeof(uint32_t));
+    const uint32_t word = static_cast<uint32_t>(cmd_buffer[1])
+                        | (static_cast<uint32_t>(cmd_buffer[2]) << 8)
+                        | (static_cast<uint32_t>(cmd_buffer[3]) << 16)
+                        | (static_cast<uint32_t>(cmd_buffer[4]) << 24);
+    const uint32_t argument = (argument_bytes == sizeof(uint32_t))
+                                  ? word
+                                  : word & ((1U << (argument_bytes * 8)) - 1);
+
+    const auto& opcode = OPCODES[cmd_buffer.front()];
+    const bool fits = argument_bytes >= opcode.min_arguments
+                   && argument_bytes <= opcode.max_arguments;
+    return protocol::Message{.command = fits ? opcode.command : protocol::Command::Unrecognised,
+                             .argument = argument};
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Size data will be once escaped.
+auto escaped_size(std::span<const uint8_t> data) -> uint32_t {
+    uint32_t size = static_cast<uint32_t>(data.size());
+    for(const auto byte : data) {
+        size += ESCAPE_TABLE[byte];
+    }
+    return size;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Build a complete frame in frame_buffer then queue it with one write. Never waits for the
+///        link. A frame there isn't room for is dropped whole, and counted in the queue's stats,
+///        rather than cut short, so callers check for room first.
+/// @param priority Send as a control frame, ahead of any bulk data still waiting.
+/// @return false if the frame was dropped.
+auto write_frame(const uint8_t opcode, std::span<const uint8_t> payload, const bool priority)
+    -> bool {
+    payload = payload.first(std::min<size_t>(payload.size(), FRAME_PAYLOAD_MAX));
+    uint32_t size = 0;
+
+    if(framing == protocol::Framing::Cobs) {
+        std::array<uint8_t, 1 + FRAME_PAYLOAD_MAX> block{};
+        block[0] = opcode;
+        std::copy(payload.begin(), payload.end(), block.begin() + 1);
+
+        frame_buffer[size++] = COBS_DELIMITER;
+        size += protocol::cobs_encode(std::span(block).first(1 + payload.size()),
+                                      std::span(frame_buffer).subspan(size));
+        frame_buffer[size++] = COBS_DELIMITER;
+    } else {
+        frame_buffer[size++] = FRAME_START;
+        frame_buffer[size++] = opcode;
+        size += protocol::escape(payload, std::span(frame_buffer).subspan(size));
+        std::copy(FRAME_TRAILER.begin(), FRAME_TRAILER.end(), frame_buffer.begin() + size);
+        size += static_cast<uint32_t>(FRAME_TRAILER.size());
+    }
+
+    const auto frame = std::span<const uint8_t>(frame_buffer).first(size);
+    return priority ? uart::try_write_priority(frame) : uart::try_write(frame);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Add a command to messages, dropping it if they're full, and switch framing if it asks.
+/// @return true if the framing changed.
+auto emit(const protocol::Message message, std::span<protocol::Message> messages, uint32_t& found)
+    -> bool {
+    using protocol::Command;
+    using protocol::Framing;
+
+    if(found < messages.size()) {
+        messages[found++] = message;
+    }
+
+    if(message.command == Command::CobsOn) {
+        protocol::set_framing(Framing::Cobs);
+        return true;
+    }
+    if(message.command == Command::CobsOff) {
+        protocol::set_framing(Framing::Escaped);
+        return true;
+    }
+    return false;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Read escaped frames from data into messages. Each byte's class is looked up and acted on
+///        in the one loop, ordinary bytes within a frame checked for first as they're most of the
+///        traffic. A start byte part way through a frame abandons it.
+/// @param data Left holding what's after a command that changed the framing, otherwise empty.
+/// @return found plus the commands added.
+auto scan_escaped(std::span<const uint8_t>& data,
+                  std::span<protocol::Message> messages,
+                  uint32_t found) -> uint32_t {
+    using protocol::Command;
+    using protocol::Message;
+
+    constexpr auto ERROR = Message{.command = Command::FrameError, .argument = 0};
+
+    // Kept in locals rather than re-read after every store through a byte pointer.
+    const uint8_t* in = data.data();
+    const uint8_t* const end = in + data.size();
+    auto current = state;
+    auto size = cmd_buffer_in_ptr;
+
+    while(in != end) {
+        const auto byte = *in++;
+
+        // Ordinary bytes within a frame are most of the traffic, so they're checked for first.
+        if(current == State::Processing && ESCAPE_TABLE[byte] == 0) {
+            // A frame too long for the buffer can't be a valid command.
+            if(size == cmd_buffer.size()) {
+                current = State::Idle;
+                if(emit(ERROR, messages, found)) {
+                    break;
+                }
+                continue;
+            }
+
+            cmd_buffer[size++] = byte;
+            continue;
+        }
+
+        if(current == State::Idle) {
+            if(byte == FRAME_START) {
+                size = 0;
+                current = State::Processing;
+            }
+            continue;
+        }
+
+        // The byte after an escape is stored whatever it is.
+        if(current == State::Escaped) {
+            current = (size == cmd_buffer.size()) ? State::Idle : State::Processing;
+            if(current == State::Processing) {
+                cmd_buffer[size++] = byte;
+            } else if(emit(ERROR, messages, found)) {
+                break;
+            }
+            continue;
+        }
+
+        if(byte == ESCAPE) {
+            current = State::Escaped;
+            continue;
+        }
 
-        case 'A': return protocol::Command::SetPaperIn;
-        case 'a': return protocol::Command::SetPaperOut;
+        // A start byte part way through a frame abandons it.
+        current = State::Idle;
+        if(emit((byte == FRAME_END) ? process_command(size) : ERROR, messages, found)) {
+            break;
+        }
+    }
 
-        case 'L': return protocol::Command::SetPlatenIn;
-        case 'l': return protocol::Command::SetPlatenOut;
+    state = current;
+    cmd_buffer_in_ptr = size;
+    data = {};
+    return found;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Read COBS frames from data into messages, decoding each once its delimiter arrives.
+///        Processing means collecting, Idle means discarding an overlong frame up to its
+///        delimiter.
+/// @param data Left holding what's after a command that changed the framing, otherwise empty.
+/// @return found plus the commands added.
+auto scan_cobs(std::span<const uint8_t>& data,
+               std::span<protocol::Message> messages,
+               uint32_t found) -> uint32_t {
+    using protocol::Command;
+    using protocol::Message;
+
+    constexpr auto ERROR = Message{.command = Command::FrameError, .argument = 0};
+
+    const uint8_t* in = data.data();
+    const uint8_t* const end = in + data.size();
+    auto current = state;
+    auto size = cmd_buffer_in_ptr;
+
+    while(in != end) {
+        const auto byte = *in++;
+        Message message{};
+
+        if(byte != COBS_DELIMITER) {
+            if(current == State::Idle) {
+                continue;
+            }
 
-        case 'R': return protocol::Command::RecordingStart;
-        case 'r': return protocol::Command::RecordingStop;
+            if(size != cmd_buffer.size()) {
+                cmd_buffer[size++] = byte;
+                continue;
+            }
+
+            current = State::Idle;
+            message = ERROR;
+        } else {
+            const bool discarding = (current == State::Idle);
+            const auto collected = size;
+            current = State::Processing;
+            size = 0;
+
+            // Back to back delimiters are just padding.
+            if(discarding || collected == 0) {
+                continue;
+            }
+
+            const auto decoded = cobs_decode(std::span(cmd_buffer).first(collected));
+            message = decoded ? process_command(decoded.value()) : ERROR;
+        }
+
+        if(emit(message, messages, found)) {
+            data = std::span(in, end);
+            return found;
+        }
+    }
+
+    state = current;
+    cmd_buffer_in_ptr = size;
+    data = {};
+    return found;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Undo cobs_encode() in place.
+/// @return Decoded size, or std::nullopt if a code byte points past the end of data.
+auto cobs_decode(std::span<uint8_t> data) -> std::optional<uint32_t> {
+    uint32_t in = 0;
+    uint32_t out = 0;
+
+    while(in < data.size()) {
+        const uint8_t code = data[in++];
+        if(code == 0 || in + code - 1 > data.size()) {
+            return std::nullopt;
+        }
+
+        for(uint32_t i = 1; i < code; i++) {
+            data[out++] = data[in++];
+        }
+
+        if(code != COBS_BLOCK_MAX && in != data.size()) {
+            data[out++] = 0;
+        }
+    }
+
+    return out;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Make an uncompressed line the reference for the next compressed one. A line that isn't a
+///        full head width leaves the reference blank, as the receiver can't know the rest of it.
+auto keep_line(std::span<const uint8_t> line) -> void {
+    if(line.size() == previous_line.size()) {
+        std::copy(line.begin(), line.end(), previous_line.begin());
+    } else {
+        previous_line.fill(0);
+    }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief XOR a burn line against the previous one and run length encode the result. Lines are
+///        mostly blank or repeats of the line before so this usually collapses to a single run.
+/// @param line   Burn line to compress. Becomes the reference for the next line.
+/// @param output Buffer to write the compressed line into.
+/// @return Number of bytes written to output.
+auto compress_line(std::span<const uint8_t> line, std::span<uint8_t> output) -> uint32_t {
+    std::array<uint8_t, mech::HEAD_BYTES> delta{};
+    for(uint32_t i = 0; i < delta.size(); i++) {
+        delta[i] = previous_line[i] ^ line[i];
+        previous_line[i] = line[i];
+    }
+
+    const auto repeats = [&delta](const uint32_t index) {
+        uint32_t count = 1;
+        while(index + count < delta.size() && count < MAX_RUN
+              && delta[index + count] == delta[index]) {
+            count++;
+        }
+        return count;
+    };
+
+    uint32_t in = 0;
+    uint32_t out = 0;
+    while(in < delta.size()) {
+        if(const auto run = repeats(in); run >= MIN_RUN) {
+            output[out++] = static_cast<uint8_t>(RUN_FLAG | (run - 1));
+            output[out++] = delta[in];
+            in += run;
+            continue;
+        }
+
+        // Gather literals until the next run worth encoding.
+        const auto control = out++;
+        uint32_t count = 0;
+        while(in < delta.size() && count < MAX_RUN && repeats(in) < MIN_RUN) {
+            output[out++] = delta[in++];
+            count++;
+        }
+        output[control] = static_cast<uint8_t>(count - 1);
+    }
+
+    return out;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto write_varint(uint32_t value, std::span<uint8_t> output) -> uint32_t {
+    uint32_t size = 0;
+    while(value >= 0x80) {
+        output[size++] = static_cast<uint8_t>(value | 0x80);
+        value >>= 7;
+    }
+    output[size++] = static_cast<uint8_t>(value);
+    return size;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto event_code(const mech::Action action) -> uint8_t {
+    switch(action) {
+        case mech::Action::Advance: return 'F';
+        case mech::Action::Reverse: return 'B';
+        case mech::Action::BurnLineStart: return 'H';
+        case mech::Action::BurnLineStop: return 'h';
+        default: return '?';
+    }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Write the low bytes of value to output, least significant first.
+/// @return Number of bytes written.
+auto write_le(const uint64_t value, const uint32_t bytes, std::span<uint8_t> output) -> uint32_t {
+    for(uint32_t i = 0; i < bytes; i++) {
+        output[i] = static_cast<uint8_t>(value >> (i * 8));
+    }
+    return bytes;
+}
+
+/*------------------------------------------------------------------------------------------------*/
 
-        default: return protocol::Command::Unrecognised;
+auto crc16(std::span<const uint8_t> data) -> uint16_t {
+    uint16_t crc = 0xFFFF;
+    for(const auto byte : data) {
+        crc = static_cast<uint16_t>((crc << 8) ^ CRC_TABLE[((crc >> 8) ^ byte) & 0xFF]);
     }
+    return crc;
 }
 
 }
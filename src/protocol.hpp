@@ -10,6 +10,13 @@
 #include <optional>
 #include <span>
 
+#include "interrupt.hpp"
+#include "mech.hpp"
+#include "ring_buffer.hpp"
+#include "scheduler.hpp"
+#include "script.hpp"
+#include "uart.hpp"
+
 /*------------------------------------------------------------------------------------------------*/
 // types
 /*------------------------------------------------------------------------------------------------*/
@@ -30,16 +37,89 @@ enum class Command : uint32_t {
 
     RecordingStart,
     RecordingStop,
+
+    CompressionOn,
+    CompressionOff,
+
+    EventBlocksOn,
+    EventBlocksOff,
+
+    TimestampsOn,
+    TimestampsOff,
+
+    Statistics,
+
+    ReliableOn,
+    ReliableOff,
+    Retransmit,
+
+    CobsOn,
+    CobsOff,
+
+    GrantCredit,
+    CreditOff,
+
+    InterruptProfile,
+    PcHistogram,
+    TaskStatistics,
+
+    SetSensors,
+
+    ScriptAdd,
+    ScriptClear,
 };
 
+/// @brief How frames are delimited, in both directions.
+enum class Framing : uint32_t {
+    Escaped, // STX opcode payload ETX CR LF, with control bytes escaped.
+    Cobs,    // 0 COBS(opcode payload) 0.
+};
+
+/// @brief Every burn line sent, compressed or not, becomes the reference the next compressed line
+///        is delta encoded against. A raw line shorter than the head resets the reference to blank.
 enum class Response : uint32_t {
     Acknowledge,
 
     MotorAdvance,
     MotorReverse,
     BurnLine,
+    BurnLineCompressed,
 };
 
+/// @brief A received command and its argument, the bytes following the opcode read as a little
+///        endian integer. Retransmit's argument is the first sequence number in its low 16 bits
+///        and the number of lines in the next 8. GrantCredit's is the number of frames granted.
+///        SetSensors' is a mask of the sensors to put in, SENSOR_PAPER and SENSOR_PLATEN.
+///        ScriptAdd's is a packed rule, see decode_rule().
+struct Message {
+    Command command;
+    uint32_t argument;
+};
+
+/// @brief A run of identical motor events within an event block.
+struct EventRun {
+    Response event;
+    uint8_t count;
+};
+
+constexpr uint32_t EVENT_BLOCK_RUNS = 32;
+constexpr uint8_t EVENT_RUN_MAX = 255;
+
+constexpr uint32_t TIMED_BLOCK_EVENTS = 16;
+
+/// @brief Largest payload any frame carries, and the most bytes a frame can take on the wire:
+///        start, opcode, every payload byte escaped, then the trailer.
+constexpr uint32_t FRAME_PAYLOAD_MAX = 128;
+constexpr uint32_t FRAME_MAX = 2 + (FRAME_PAYLOAD_MAX * 2) + 3;
+
+/// @brief Largest payload sent as a control frame, an interrupt profile, and the most bytes it can
+///        take on the wire.
+constexpr uint32_t CONTROL_PAYLOAD_MAX = 1 + 4 + 8 + 4 + (interrupt::LATENCY_BUCKETS * 4);
+constexpr uint32_t CONTROL_FRAME_MAX = 2 + (CONTROL_PAYLOAD_MAX * 2) + 3;
+
+constexpr uint8_t SENSOR_PAPER = 0b01;
+constexpr uint8_t SENSOR_PLATEN = 0b10;
+
 }
 
 /*------------------------------------------------------------------------------------------------*/
@@ -48,10 +128,44 @@ enum class Response : uint32_t {
 
 namespace protocol {
 
-auto process_byte(uint8_t byte) -> std::optional<Command>;
+auto process(std::span<const uint8_t> data, std::span<Message> messages) -> uint32_t;
+
+auto set_framing(Framing mode) -> void;
+
+auto decode_rule(uint32_t argument) -> std::optional<script::Rule>;
+
+auto reply_room() -> bool;
+auto frame_room() -> bool;
 
 auto send_response(Response response, std::optional<const std::span<const uint8_t>> data) -> void;
 
+auto send_burn_line(std::span<const uint8_t> line) -> uart::Ticket;
+
+auto send_event_block(std::span<const EventRun> runs) -> void;
+
+auto send_timed_events(std::span<const mech::Event> events, uint32_t reference) -> void;
+
+auto send_sensor_state(uint8_t sensors, uint32_t latency) -> void;
+
+auto send_statistics(const uart::Queues& uart_queues, const mech::Queues& mech_queues) -> void;
+
+auto send_interrupt_profile(uint8_t source, const interrupt::Profile& profile) -> void;
+
+auto send_task_stats(scheduler::Task task, const scheduler::TaskStats& stats) -> void;
+
+auto send_pc_histogram(uint32_t low_pc,
+                       uint32_t bucket_size,
+                       std::span<const uint16_t> buckets,
+                       uint32_t first) -> uint32_t;
+
+auto send_reliable_line(std::span<const uint8_t> line, bool compressed) -> void;
+auto retransmit(uint16_t sequence) -> void;
+
+auto clear() -> void;
+
+auto escape(std::span<const uint8_t> data, std::span<uint8_t> output) -> uint32_t;
+auto cobs_encode(std::span<const uint8_t> data, std::span<uint8_t> output) -> uint32_t;
+
 }
 
 /*------------------------------------------------------------------------------------------------*/
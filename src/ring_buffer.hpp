@@ -0,0 +1,296 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    ring_buffer.hpp
+/// @brief   Single producer, single consumer ring buffer for passing data to and from ISRs.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <span>
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief What a ring buffer does with a push when it's full.
+enum class Overflow {
+    Block,      // Wait for the consumer. Only for producers the consumer can interrupt.
+    DropNewest, // Discard the element being pushed.
+    DropOldest, // Overwrite the oldest element. The consumer must only use pop().
+};
+
+/// @brief Usage of a queue since it was created.
+struct QueueStats {
+    uint32_t high_water;
+    uint32_t dropped;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Lock free ring buffer with one producer and one consumer, typically an ISR and the main
+///        loop. The producer is the only writer of _head and the consumer the only writer of _tail
+///        so neither side needs to mask interrupts. Indexes are free running and masked on access.
+///
+///        Only for an ISR and the code it interrupts on the same core. volatile and signal fences
+///        order accesses against an interrupt, which sees memory as its own core does, but not
+///        against another thread or core. Between real threads use std::atomic indexes instead.
+/// @tparam T Element type.
+/// @tparam N Capacity. Must be a power of two.
+/// @tparam POLICY What to do when a push finds the buffer full.
+template<typename T, uint32_t N, Overflow POLICY = Overflow::DropNewest>
+class RingBuffer {
+    static_assert(N != 0 && (N & (N - 1)) == 0, "RingBuffer capacity must be a power of two");
+
+public:
+    static constexpr auto capacity() -> uint32_t {
+        return N;
+    }
+
+    auto size() const -> uint32_t {
+        // A drop oldest producer may be ahead of the consumer by more than N until it resyncs.
+        return std::min(_head - _tail, N);
+    }
+
+    auto free() const -> uint32_t {
+        return N - size();
+    }
+
+    auto empty() const -> bool {
+        return _head == _tail;
+    }
+
+    auto full() const -> bool {
+        return size() == N;
+    }
+
+    /// @brief Total number of elements ever pushed. Wraps.
+    auto pushed() const -> uint32_t {
+        return _head;
+    }
+
+    /// @brief Total number of elements ever popped. Wraps.
+    auto popped() const -> uint32_t {
+        return _tail;
+    }
+
+    auto stats() const -> QueueStats {
+        return QueueStats{.high_water = _high_water, .dropped = _dropped};
+    }
+
+    /*--------------------------------------------------------------------------------------------*/
+    // Producer side.
+    /*--------------------------------------------------------------------------------------------*/
+
+    /// @brief Push a single element.
+    /// @return false if the buffer was full and the element was dropped.
+    auto push(const T& item) -> bool {
+        const uint32_t head = _head;
+        if constexpr(POLICY == Overflow::Block) {
+            while(head - _tail == N) {}
+        } else if constexpr(POLICY == Overflow::DropNewest) {
+            if(head - _tail == N) {
+                _dropped = _dropped + 1;
+                return false;
+            }
+        }
+
+        _buffer[head & MASK] = item;
+        publish(head + 1);
+        return true;
+    }
+
+    /// @brief Push as many elements as will fit.
+    /// @return Number of elements pushed.
+    auto push(std::span<const T> items) -> uint32_t {
+        if constexpr(POLICY == Overflow::DropOldest) {
+            for(const auto& item : items) {
+                push(item);
+            }
+            return static_cast<uint32_t>(items.size());
+        } else {
+            uint32_t pushed = 0;
+            while(pushed < items.size()) {
+                const auto space = write_span();
+                if(space.empty()) {
+                    if constexpr(POLICY == Overflow::Block) {
+                        continue;
+                    }
+
+                    _dropped = _dropped + static_cast<uint32_t>(items.size() - pushed);
+                    break;
+                }
+
+                const auto remaining = items.size() - pushed;
+                const auto count = static_cast<uint32_t>(std::min(space.size(), remaining));
+                std::copy_n(items.begin() + pushed, count, space.begin());
+                commit(count);
+                pushed += count;
+            }
+            return pushed;
+        }
+    }
+
+    /// @brief Contiguous free space the producer can fill in place before calling commit(). May be
+    ///        smaller than free() when the free space wraps.
+    auto write_span() -> std::span<T> {
+        static_assert(POLICY != Overflow::DropOldest, "No in place access with DropOldest");
+
+        const uint32_t head = _head;
+        const uint32_t index = head & MASK;
+        const uint32_t count = std::min(N - (head - _tail), N - index);
+        return std::span<T>(&_buffer[index], count);
+    }
+
+    /// @brief Publish elements written in place through write_span().
+    auto commit(const uint32_t count) -> void {
+        publish(_head + count);
+    }
+
+    /// @brief Count elements the producer discarded itself rather than pushing, e.g. when
+    ///        write_span() was empty.
+    auto record_drop(const uint32_t count = 1) -> void {
+        static_assert(POLICY != Overflow::DropOldest, "DropOldest consumer counts drops");
+
+        _dropped = _dropped + count;
+    }
+
+    /*--------------------------------------------------------------------------------------------*/
+    // Consumer side.
+    /*--------------------------------------------------------------------------------------------*/
+
+    /// @brief Pop a single element.
+    auto pop() -> std::optional<T> {
+        while(true) {
+            const uint32_t tail = _tail;
+            if(tail == _head) {
+                return std::nullopt;
+            }
+
+            if constexpr(POLICY == Overflow::DropOldest) {
+                if(resync()) {
+                    continue;
+                }
+            }
+
+            std::atomic_signal_fence(std::memory_order_acquire);
+            const T item = _buffer[tail & MASK];
+
+            // The producer may have overwritten the element while it was being copied.
+            if constexpr(POLICY == Overflow::DropOldest) {
+                std::atomic_signal_fence(std::memory_order_acquire);
+                if(resync()) {
+                    continue;
+                }
+            }
+
+            release(tail + 1);
+            return item;
+        }
+    }
+
+    /// @brief Pop as many elements as are available, up to the size of items.
+    /// @return Number of elements popped.
+    auto pop(std::span<T> items) -> uint32_t {
+        if constexpr(POLICY == Overflow::DropOldest) {
+            uint32_t popped = 0;
+            while(popped < items.size()) {
+                const auto item = pop();
+                if(!item) {
+                    break;
+                }
+                items[popped++] = item.value();
+            }
+            return popped;
+        } else {
+            uint32_t popped = 0;
+            while(popped < items.size()) {
+                const auto available = read_span();
+                if(available.empty()) {
+                    break;
+                }
+
+                const auto remaining = items.size() - popped;
+                const auto count = static_cast<uint32_t>(std::min(available.size(), remaining));
+                std::copy_n(available.begin(), count, items.begin() + popped);
+                consume(count);
+                popped += count;
+            }
+            return popped;
+        }
+    }
+
+    /// @brief Contiguous elements the consumer can read in place before calling consume(). May be
+    ///        smaller than size() when the data wraps.
+    auto read_span() const -> std::span<const T> {
+        static_assert(POLICY != Overflow::DropOldest, "No in place access with DropOldest");
+
+        const uint32_t tail = _tail;
+        const uint32_t index = tail & MASK;
+        const uint32_t count = std::min(_head - tail, N - index);
+        std::atomic_signal_fence(std::memory_order_acquire);
+        return std::span<const T>(&_buffer[index], count);
+    }
+
+    /// @brief Element offset places from the oldest, without removing it. offset must be less than
+    ///        size().
+    auto at(const uint32_t offset) const -> const T& {
+        static_assert(POLICY != Overflow::DropOldest, "No in place access with DropOldest");
+
+        std::atomic_signal_fence(std::memory_order_acquire);
+        return _buffer[(_tail + offset) & MASK];
+    }
+
+    /// @brief Release elements read in place through read_span() or at().
+    auto consume(const uint32_t count) -> void {
+        release(_tail + count);
+    }
+
+    /// @brief Discard everything currently in the buffer.
+    auto clear() -> void {
+        release(_head);
+    }
+
+private:
+    static constexpr uint32_t MASK = N - 1;
+
+    std::array<T, N> _buffer{};
+    volatile uint32_t _head{0};
+    volatile uint32_t _tail{0};
+
+    // Written by the producer, except _dropped which the consumer owns under DropOldest.
+    volatile uint32_t _high_water{0};
+    volatile uint32_t _dropped{0};
+
+    auto publish(const uint32_t head) -> void {
+        std::atomic_signal_fence(std::memory_order_release);
+        _head = head;
+
+        if(const uint32_t size = std::min(head - _tail, N); size > _high_water) {
+            _high_water = size;
+        }
+    }
+
+    /// @brief Skip past elements a DropOldest producer has overwritten.
+    /// @return true if any were skipped.
+    auto resync() -> bool {
+        const uint32_t head = _head;
+        const uint32_t tail = _tail;
+        if(head - tail <= N) {
+            return false;
+        }
+
+        _dropped = _dropped + (head - tail - N);
+        release(head - N);
+        return true;
+    }
+
+    auto release(const uint32_t tail) -> void {
+        std::atomic_signal_fence(std::memory_order_release);
+        _tail = tail;
+    }
+};
+
+/*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,142 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    sampler.cpp
+/// @brief   Statistical profiler sampling the program counter into a histogram over .text.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <array>
+#include <cstdint>
+#include <span>
+
+#include "mb_interface.h"
+#include "xil_io.h"
+#include "xparameters.h"
+
+#include "interrupt.hpp"
+#include "sampler.hpp"
+#include "timer.hpp"
+
+/*------------------------------------------------------------------------------------------------*/
+
+#if defined(PC_SAMPLING) && defined(XPAR_INTC_0_TMRCTR_0_VEC_ID)
+
+// Bounds of .text from the linker script.
+extern "C" const uint8_t __text_start[];
+extern "C" const uint8_t __text_end[];
+
+namespace {
+
+constexpr uint32_t BASE_ADDRESS = XPAR_TMRCTR_0_BASEADDR;
+
+// AXI Timer counter 1 registers. Counter 0 is left free running for timer::now().
+constexpr uint32_t TCSR1_OFFSET = 0x10;
+constexpr uint32_t TLR1_OFFSET = 0x14;
+
+constexpr uint32_t TCSR_UDT = 0x002;
+constexpr uint32_t TCSR_ARHT = 0x010;
+constexpr uint32_t TCSR_LOAD = 0x020;
+constexpr uint32_t TCSR_ENIT = 0x040;
+constexpr uint32_t TCSR_ENT = 0x080;
+constexpr uint32_t TCSR_TINT = 0x100;
+
+// Counts saturate rather than wrap so a hot spot can't disappear.
+constinit std::array<uint16_t, sampler::BUCKETS> buckets{};
+constinit UINTPTR text_start{0};
+constinit uint32_t text_size{0};
+constinit uint32_t size_of_bucket{4};
+
+void sample_isr(void* CallbackRef);
+
+}
+
+#endif
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto sampler::init() -> void {
+#if defined(PC_SAMPLING) && defined(XPAR_INTC_0_TMRCTR_0_VEC_ID)
+    text_start = reinterpret_cast<UINTPTR>(__text_start);
+    text_size = static_cast<uint32_t>(__text_end - __text_start);
+
+    // Whole instructions per bucket, enough of them to cover all of .text.
+    const uint32_t instructions = (text_size + 3) / 4;
+    size_of_bucket = ((instructions + BUCKETS - 1) / BUCKETS) * 4;
+
+    interrupt::enable(interrupt::Timer, sample_isr, nullptr);
+
+    // Count down from the reload value, interrupting and reloading each time it expires.
+    Xil_Out32(BASE_ADDRESS + TLR1_OFFSET, (timer::FREQUENCY / SAMPLE_RATE) - 1);
+    Xil_Out32(BASE_ADDRESS + TCSR1_OFFSET, TCSR_LOAD | TCSR_TINT);
+    Xil_Out32(BASE_ADDRESS + TCSR1_OFFSET, TCSR_UDT | TCSR_ARHT | TCSR_ENIT | TCSR_ENT);
+#endif
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Address of the first bucket. Only its low 32 bits on a 64 bit host.
+auto sampler::low_pc() -> uint32_t {
+#if defined(PC_SAMPLING) && defined(XPAR_INTC_0_TMRCTR_0_VEC_ID)
+    return static_cast<uint32_t>(text_start);
+#else
+    return 0;
+#endif
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Bytes of .text covered by each bucket.
+auto sampler::bucket_size() -> uint32_t {
+#if defined(PC_SAMPLING) && defined(XPAR_INTC_0_TMRCTR_0_VEC_ID)
+    return size_of_bucket;
+#else
+    return 0;
+#endif
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Samples per bucket, lowest address first. Empty if sampling isn't available.
+auto sampler::histogram() -> std::span<const uint16_t> {
+#if defined(PC_SAMPLING) && defined(XPAR_INTC_0_TMRCTR_0_VEC_ID)
+    return buckets;
+#else
+    return {};
+#endif
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto sampler::clear() -> void {
+#if defined(PC_SAMPLING) && defined(XPAR_INTC_0_TMRCTR_0_VEC_ID)
+    buckets.fill(0);
+#endif
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+#if defined(PC_SAMPLING) && defined(XPAR_INTC_0_TMRCTR_0_VEC_ID)
+
+namespace {
+
+void sample_isr([[maybe_unused]] void* CallbackRef) {
+    // r14 holds the address the interrupt will return to, which is where it was taken.
+    const UINTPTR pc = mfgpr(r14);
+
+    Xil_Out32(BASE_ADDRESS + TCSR1_OFFSET, Xil_In32(BASE_ADDRESS + TCSR1_OFFSET) | TCSR_TINT);
+    interrupt::acknowledge(interrupt::Timer);
+
+    const UINTPTR offset = pc - text_start;
+    if(offset < text_size) {
+        auto& count = buckets[offset / size_of_bucket];
+        if(count != UINT16_MAX) {
+            count++;
+        }
+    }
+}
+
+}
+
+#endif
+
+/*------------------------------------------------------------------------------------------------*/
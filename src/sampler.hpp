@@ -0,0 +1,45 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    sampler.hpp
+/// @brief   Statistical profiler sampling the program counter into a histogram over .text.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+#include "xparameters.h"
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace sampler {
+
+/// Built in with the pc_sampling meson option. Samples are taken from AXI Timer counter 1 so it
+/// also needs a timer with its interrupt connected.
+#if defined(PC_SAMPLING) && defined(XPAR_INTC_0_TMRCTR_0_VEC_ID)
+constexpr bool AVAILABLE = true;
+#else
+constexpr bool AVAILABLE = false;
+#endif
+
+constexpr uint32_t BUCKETS = 512;
+constexpr uint32_t SAMPLE_RATE = 1000;
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace sampler {
+
+auto init() -> void;
+
+auto low_pc() -> uint32_t;
+auto bucket_size() -> uint32_t;
+auto histogram() -> std::span<const uint16_t>;
+
+auto clear() -> void;
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
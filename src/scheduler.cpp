@@ -0,0 +1,80 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    scheduler.cpp
+/// @brief   Cooperative run to completion scheduler for the main loop's work.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <optional>
+
+#include "scheduler.hpp"
+#include "timer.hpp"
+
+/*------------------------------------------------------------------------------------------------*/
+// private variables
+/*------------------------------------------------------------------------------------------------*/
+
+namespace {
+
+// One flag per task rather than a mask so that setting one from an ISR is a single store and
+// never races with the scheduler clearing another. A task's flag is cleared before it runs so a
+// signal arriving while it's running isn't lost.
+constinit std::array<volatile bool, scheduler::TASK_COUNT> ready{};
+
+constinit std::array<scheduler::TaskStats, scheduler::TASK_COUNT> task_stats{};
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// public functions
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Run the tasks forever. Every task starts ready.
+auto scheduler::run(const std::array<TaskConfig, TASK_COUNT>& tasks) -> void {
+    std::ranges::fill(ready, true);
+
+    while(true) {
+        for(uint8_t id = 0; id < TASK_COUNT; id++) {
+            const auto& task = tasks[id];
+            if(!task.polled && !ready[id]) {
+                continue;
+            }
+            ready[id] = false;
+
+            const auto start = timer::now();
+            const bool more = task.function(task.budget);
+            const auto cycles = timer::now() - start;
+
+            if(more) {
+                ready[id] = true;
+            }
+
+            auto& stats = task_stats[id];
+            stats.runs++;
+            stats.exhausted += more ? 1 : 0;
+            stats.total_cycles += cycles;
+            stats.max_cycles = std::max(stats.max_cycles, cycles);
+        }
+    }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Mark a task as having work to do. Safe to call from an ISR.
+auto scheduler::signal(const Task task) -> void {
+    ready[task] = true;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto scheduler::stats(const Task task) -> std::optional<TaskStats> {
+    if(task >= TASK_COUNT) {
+        return std::nullopt;
+    }
+    return task_stats[task];
+}
+
+/*------------------------------------------------------------------------------------------------*/
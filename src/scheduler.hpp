@@ -0,0 +1,63 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    scheduler.hpp
+/// @brief   Cooperative run to completion scheduler for the main loop's work.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+
+/*------------------------------------------------------------------------------------------------*/
+// public types.
+/*------------------------------------------------------------------------------------------------*/
+
+namespace scheduler {
+
+/// @brief Tasks in priority order. Each pass runs every ready task once, highest priority first.
+enum Task : uint8_t {
+    Commands, // Parse received bytes and handle the commands in them.
+    Script,   // Apply script actions too slow for an ISR.
+    Stream,   // Send recorded mech activity to the host.
+    Button,   // Poll the button and mirror it on the LEDs.
+};
+
+constexpr uint32_t TASK_COUNT = 4;
+
+/// @brief Does up to budget units of work.
+/// @return true if there's more to do, keeping the task ready.
+using Function = auto (*)(uint32_t budget) -> bool;
+
+struct TaskConfig {
+    Function function;
+    uint32_t budget;
+    bool polled; // Run on every pass rather than only when signalled.
+};
+
+/// @brief What a task has cost since start up. Cycles are 0 without a timer.
+struct TaskStats {
+    uint32_t runs;
+    uint32_t exhausted; // Runs that used their whole budget with work left over.
+    uint64_t total_cycles;
+    uint32_t max_cycles;
+};
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// public functions
+/*------------------------------------------------------------------------------------------------*/
+
+namespace scheduler {
+
+[[noreturn]] auto run(const std::array<TaskConfig, TASK_COUNT>& tasks) -> void;
+
+auto signal(Task task) -> void;
+
+auto stats(Task task) -> std::optional<TaskStats>;
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,187 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    script.cpp
+/// @brief   Stimulus script firing sensor and temperature changes at set points in a print.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <array>
+#include <cstdint>
+
+#include "io.hpp"
+#include "scheduler.hpp"
+#include "script.hpp"
+#include "thermistor.hpp"
+
+/*------------------------------------------------------------------------------------------------*/
+// private types
+/*------------------------------------------------------------------------------------------------*/
+
+namespace {
+
+/// @brief A trigger's rules in the order they fire, and how far through them it's got.
+struct Track {
+    std::array<script::Rule, script::RULES_MAX> rules;
+    uint32_t size;
+    uint32_t next;
+    uint32_t count;
+};
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// private variables
+/*------------------------------------------------------------------------------------------------*/
+
+namespace {
+
+// Rules are only changed while stopped. While running, each track is only touched by the ISR for
+// its trigger.
+constinit std::array<Track, 2> tracks{};
+constinit volatile bool running{false};
+
+// SPI can't be driven from an ISR so temperatures are left for the main loop to apply.
+constinit volatile int32_t temperature{0};
+constinit volatile bool temperature_pending{false};
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// private functions
+/*------------------------------------------------------------------------------------------------*/
+
+namespace {
+
+auto advance(Track& track) -> void;
+auto fire_due(Track& track) -> void;
+auto fire(const script::Rule& rule) -> void;
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// public functions
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Add a rule, keeping its track in firing order.
+/// @return false if the script is running or its track is full.
+auto script::add(const Rule& rule) -> bool {
+    auto& track = tracks[static_cast<uint8_t>(rule.trigger)];
+    if(running || track.size == RULES_MAX) {
+        return false;
+    }
+
+    // Insert after any rules due at the same count so they fire in the order they were added.
+    uint32_t index = track.size;
+    while(index != 0 && track.rules[index - 1].count > rule.count) {
+        track.rules[index] = track.rules[index - 1];
+        index--;
+    }
+
+    track.rules[index] = rule;
+    track.size++;
+    return true;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto script::clear() -> void {
+    stop();
+    for(auto& track : tracks) {
+        track.size = 0;
+    }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Start counting from zero. Rules with a count of 0 fire straight away.
+auto script::start() -> void {
+    stop();
+    for(auto& track : tracks) {
+        track.next = 0;
+        track.count = 0;
+        fire_due(track);
+    }
+    running = true;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto script::stop() -> void {
+    running = false;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Count a motor advance step. Called from its ISR.
+auto script::step() -> void {
+    advance(tracks[static_cast<uint8_t>(Trigger::Steps)]);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Count a burned line. Called from the ISR marking the end of the head's burn.
+auto script::line() -> void {
+    advance(tracks[static_cast<uint8_t>(Trigger::Lines)]);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Set the temperature a rule last asked for, if there's one waiting.
+auto script::apply_temperature() -> void {
+    if(!temperature_pending) {
+        return;
+    }
+
+    // Cleared first so a rule firing while the value's read is picked up next time.
+    temperature_pending = false;
+    thermistor::set_temp(temperature);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// private functions
+/*------------------------------------------------------------------------------------------------*/
+
+namespace {
+
+/// @brief Only compares against the next rule due so costs the same however long the script is.
+auto advance(Track& track) -> void {
+    if(!running) {
+        return;
+    }
+
+    track.count++;
+    fire_due(track);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto fire_due(Track& track) -> void {
+    while(track.next < track.size && track.rules[track.next].count <= track.count) {
+        fire(track.rules[track.next]);
+        track.next++;
+    }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto fire(const script::Rule& rule) -> void {
+    using enum script::Action;
+
+    switch(rule.action) {
+        case PaperOut: io::paper_out(); break;
+        case PaperIn: io::paper_in(); break;
+        case PlatenOut: io::platen_out(); break;
+        case PlatenIn: io::platen_in(); break;
+
+        case SetTemperature: {
+            temperature = rule.value;
+            temperature_pending = true;
+            scheduler::signal(scheduler::Script);
+            break;
+        }
+    }
+}
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
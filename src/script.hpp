@@ -0,0 +1,63 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    script.hpp
+/// @brief   Stimulus script firing sensor and temperature changes at set points in a print.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cstdint>
+
+/*------------------------------------------------------------------------------------------------*/
+// public types
+/*------------------------------------------------------------------------------------------------*/
+
+namespace script {
+
+/// @brief What a rule counts, from when the script is started.
+enum class Trigger : uint8_t {
+    Steps, // Motor advance steps.
+    Lines, // Burned lines.
+};
+
+enum class Action : uint8_t {
+    PaperOut,
+    PaperIn,
+    PlatenOut,
+    PlatenIn,
+    SetTemperature,
+};
+
+/// @brief Perform action once count triggers have happened. value is the temperature for
+///        SetTemperature and unused otherwise.
+struct Rule {
+    Trigger trigger;
+    Action action;
+    int8_t value;
+    uint32_t count;
+};
+
+constexpr uint32_t RULES_MAX = 16;
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// public functions
+/*------------------------------------------------------------------------------------------------*/
+
+namespace script {
+
+auto add(const Rule& rule) -> bool;
+auto clear() -> void;
+
+auto start() -> void;
+auto stop() -> void;
+
+auto step() -> void;
+auto line() -> void;
+
+auto apply_temperature() -> void;
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,358 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    stream.cpp
+/// @brief   Module for streaming recorded print mechanism activity to the host.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <array>
+#include <cstdint>
+#include <optional>
+
+#include "coroutine.hpp"
+#include "mech.hpp"
+#include "protocol.hpp"
+#include "ring_buffer.hpp"
+#include "stream.hpp"
+#include "uart.hpp"
+
+using namespace std::literals;
+
+/*------------------------------------------------------------------------------------------------*/
+// private variables
+/*------------------------------------------------------------------------------------------------*/
+
+namespace {
+
+constinit bool compress{false};
+constinit bool batch{false};
+constinit bool timestamp{false};
+constinit bool reliable{false};
+
+// With credit enabled a frame is only sent for each one the host has granted. Events and lines
+// wait in the mech buffers until there's credit to send them.
+constinit bool credit_enabled{false};
+constinit uint32_t credit{0};
+
+// Sends the recorded events. Replaced with a fresh task whenever the stream is cleared.
+constinit coroutine::Task streamer{};
+
+// Sequence number of the last burn line sent, used to spot dropped lines.
+constinit std::optional<uint32_t> line_sequence{};
+
+// Lines still being sent from their slots, oldest first.
+constinit RingBuffer<uart::Ticket, 8> lines_sending{};
+
+// Motor events waiting to go out in an event block.
+constinit std::array<protocol::EventRun, protocol::EVENT_BLOCK_RUNS> block{};
+constinit uint32_t block_runs{0};
+
+// Events waiting to go out in a timestamped event frame, and the time of the last one sent.
+constinit std::array<mech::Event, protocol::TIMED_BLOCK_EVENTS> timed{};
+constinit uint32_t timed_events{0};
+constinit uint32_t timed_reference{0};
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// private functions
+/*------------------------------------------------------------------------------------------------*/
+
+namespace {
+
+auto send_events() -> coroutine::Task;
+
+auto send_event(mech::Event event) -> void;
+
+auto send_burn_line(const mech::BurnLine& burn_line) -> void;
+
+auto release_sent_lines() -> void;
+
+auto send_batched(bool charged) -> void;
+
+auto frames_for(mech::Event event) -> uint32_t;
+auto frames_pending() -> uint32_t;
+auto has_credit(uint32_t frames) -> bool;
+auto spend_credit() -> void;
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// public functions
+/*------------------------------------------------------------------------------------------------*/
+
+auto stream::clear() -> void {
+    // Let lines finish going out before their slots are freed.
+    while(!lines_sending.empty()) {
+        release_sent_lines();
+    }
+
+    protocol::clear();
+    line_sequence.reset();
+    block_runs = 0;
+    timed_events = 0;
+    timed_reference = 0;
+
+    // Start over, dropping any event the old task was holding on to.
+    streamer = send_events();
+    if(!streamer.valid() || !coroutine::spawn(streamer)) {
+        uart::write("Error: no room to start streaming.\r\n"sv);
+    }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Send anything batched. As this is done in answer to a command rather than to stream
+///        events it isn't charged against credit.
+auto stream::flush() -> void {
+    send_batched(false);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Whether flush() can send everything batched without waiting for the link. Commands
+///        that flush are held until it can.
+auto stream::flush_room() -> bool {
+    return uart::free() >= frames_pending() * protocol::FRAME_MAX;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto stream::set_compression(const bool enable) -> void {
+    compress = enable;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto stream::set_batching(const bool enable) -> void {
+    flush();
+    batch = enable;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto stream::set_timestamps(const bool enable) -> void {
+    flush();
+    timestamp = enable;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto stream::set_reliable(const bool enable) -> void {
+    reliable = enable;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Add to the frames that may be sent, turning credit on if it wasn't already.
+auto stream::grant_credit(const uint32_t frames) -> void {
+    if(!credit_enabled) {
+        credit_enabled = true;
+        credit = 0;
+    }
+
+    credit = (frames > UINT32_MAX - credit) ? UINT32_MAX : credit + frames;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto stream::disable_credit() -> void {
+    credit_enabled = false;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// private functions
+/*------------------------------------------------------------------------------------------------*/
+
+namespace {
+
+/// @brief Send recorded events as they arrive, one per resume.
+auto send_events() -> coroutine::Task {
+    while(true) {
+        const auto event = co_await coroutine::until([] {
+            release_sent_lines();
+            const auto next = mech::get_next_event();
+
+            // Nothing else to add so send anything batched once the link has gone idle.
+            if(!next && uart::idle() && has_credit(frames_pending())) {
+                send_batched(true);
+            }
+            return next;
+        });
+
+        // Wait for room to send whatever the event sends, so write_frame() never has to spin.
+        co_await coroutine::until([&event] {
+            const auto frames = frames_for(event.value());
+            return has_credit(frames) && uart::free() >= frames * protocol::FRAME_MAX;
+        });
+
+        if(event->action == mech::Action::BurnLineStop) {
+            // Hold on to the event until there's room to track its line and the line turns up.
+            co_await coroutine::until([] {
+                release_sent_lines();
+                return !lines_sending.full();
+            });
+            const auto* const burn_line = co_await coroutine::until(mech::read_burn_line);
+
+            send_event(event.value());
+            send_burn_line(*burn_line);
+        } else {
+            send_event(event.value());
+        }
+
+        co_await coroutine::yield();
+    }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto send_event(const mech::Event event) -> void {
+    using enum mech::Action;
+
+    // Timestamped frames carry every event so head on time can be measured too.
+    if(timestamp) {
+        timed[timed_events++] = event;
+        if(timed_events == timed.size()) {
+            send_batched(true);
+        }
+        return;
+    }
+
+    if(event.action != Advance && event.action != Reverse) {
+        return;
+    }
+
+    const auto response = (event.action == Advance) ? protocol::Response::MotorAdvance
+                                                    : protocol::Response::MotorReverse;
+
+    if(!batch) {
+        protocol::send_response(response, std::nullopt);
+        spend_credit();
+        return;
+    }
+
+    // Extend the current run where possible, otherwise start a new one.
+    if(block_runs != 0) {
+        auto& run = block[block_runs - 1];
+        if(run.event == response && run.count < protocol::EVENT_RUN_MAX) {
+            run.count++;
+            return;
+        }
+    }
+
+    block[block_runs++] = protocol::EventRun{.event = response, .count = 1};
+
+    if(block_runs == block.size()) {
+        send_batched(true);
+    }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto send_burn_line(const mech::BurnLine& burn_line) -> void {
+    using enum protocol::Response;
+
+    // Keep the events that came before the line ahead of it.
+    send_batched(true);
+
+    if(line_sequence && burn_line.sequence != line_sequence.value() + 1) {
+        uart::write("Error: burn lines were dropped.\r\n"sv);
+    }
+    line_sequence = burn_line.sequence;
+
+    if(reliable) {
+        protocol::send_reliable_line(burn_line.bytes(), compress);
+        lines_sending.push(uart::ticket());
+    } else if(compress) {
+        protocol::send_response(BurnLineCompressed, burn_line.bytes());
+        lines_sending.push(uart::ticket());
+    } else {
+        lines_sending.push(protocol::send_burn_line(burn_line.bytes()));
+    }
+    spend_credit();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto release_sent_lines() -> void {
+    while(!lines_sending.empty() && uart::sent(lines_sending.at(0))) {
+        lines_sending.consume(1);
+        mech::release_burn_line();
+    }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Send the batched event block and timestamped events, if any.
+/// @param charged Whether each frame sent uses up a credit.
+auto send_batched(const bool charged) -> void {
+    if(block_runs != 0) {
+        protocol::send_event_block(std::span(block).first(block_runs));
+        if(charged) {
+            spend_credit();
+        }
+        block_runs = 0;
+    }
+
+    if(timed_events != 0) {
+        protocol::send_timed_events(std::span(timed).first(timed_events), timed_reference);
+        if(charged) {
+            spend_credit();
+        }
+        timed_reference = timed[timed_events - 1].time;
+        timed_events = 0;
+    }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Most frames handling event can send, so it's only taken once there's credit for all of
+///        them.
+auto frames_for(const mech::Event event) -> uint32_t {
+    using enum mech::Action;
+
+    // A line sends whatever's batched ahead of it then itself. Timestamped, its own event is
+    // always batched ahead of it.
+    if(event.action == BurnLineStop) {
+        return timestamp ? 2 : frames_pending() + 1;
+    }
+
+    if(timestamp) {
+        return (timed_events + 1 == timed.size()) ? 1 : 0;
+    }
+
+    if(event.action != Advance && event.action != Reverse) {
+        return 0;
+    }
+
+    if(!batch) {
+        return 1;
+    }
+
+    return (block_runs + 1 == block.size()) ? 1 : 0;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Frames send_batched() would send.
+auto frames_pending() -> uint32_t {
+    return static_cast<uint32_t>(block_runs != 0) + static_cast<uint32_t>(timed_events != 0);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto has_credit(const uint32_t frames) -> bool {
+    return !credit_enabled || credit >= frames;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto spend_credit() -> void {
+    if(credit_enabled && credit != 0) {
+        credit--;
+    }
+}
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
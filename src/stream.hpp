@@ -0,0 +1,35 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    stream.hpp
+/// @brief   Module for streaming recorded print mechanism activity to the host.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cstdint>
+
+/*------------------------------------------------------------------------------------------------*/
+// public functions
+/*------------------------------------------------------------------------------------------------*/
+
+namespace stream {
+
+auto clear() -> void;
+
+auto flush() -> void;
+auto flush_room() -> bool;
+
+auto set_compression(bool enable) -> void;
+
+auto set_batching(bool enable) -> void;
+
+auto set_timestamps(bool enable) -> void;
+
+auto set_reliable(bool enable) -> void;
+
+auto grant_credit(uint32_t frames) -> void;
+auto disable_credit() -> void;
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -6,12 +6,126 @@
 ///          thermistor.
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+#include <algorithm>
+#include <array>
 #include <cstdint>
+#include <functional>
 
 #include "xspi.h"
 
 #include "thermistor.hpp"
 
+// The parts are set with meson options. These defaults put the wiper mid scale at 25C.
+#ifndef THERMISTOR_R25
+#define THERMISTOR_R25 10000
+#endif
+#ifndef THERMISTOR_B
+#define THERMISTOR_B 3950
+#endif
+#ifndef POTENTIOMETER_RESISTANCE
+#define POTENTIOMETER_RESISTANCE 20000
+#endif
+#ifndef POTENTIOMETER_WIPER
+#define POTENTIOMETER_WIPER 50
+#endif
+
+/*------------------------------------------------------------------------------------------------*/
+// private constants
+/*------------------------------------------------------------------------------------------------*/
+
+namespace {
+
+// The head's NTC, described by its B parameter curve R = R25 * e^(B * (1/T - 1/T25)).
+constexpr double NTC_R25 = THERMISTOR_R25;
+constexpr double NTC_B = THERMISTOR_B;
+constexpr double NTC_T25 = 298.15;
+constexpr double KELVIN = 273.15;
+
+// The digital potentiometer standing in for it. The wiper to B resistance is
+// code / POT_CODES * POT_RESISTANCE plus the wiper's own resistance.
+constexpr double POT_RESISTANCE = POTENTIOMETER_RESISTANCE;
+constexpr double POT_WIPER_RESISTANCE = POTENTIOMETER_WIPER;
+constexpr uint32_t POT_CODES = 256;
+
+/// @brief e^x, accurate to double precision. Only used to build tables at compile time.
+constexpr auto exponential(const double x) -> double {
+    constexpr double LN2 = 0.693147180559945309417;
+
+    // e^x = 2^k * e^r with |r| <= ln(2) / 2, so the series converges quickly.
+    const auto k = static_cast<int32_t>(x / LN2 + (x < 0 ? -0.5 : 0.5));
+    const double r = x - (k * LN2);
+
+    double sum = 1.0;
+    double term = 1.0;
+    for(int32_t n = 1; n < 24; n++) {
+        term *= r / n;
+        sum += term;
+    }
+
+    for(int32_t i = 0; i < k; i++) {
+        sum *= 2.0;
+    }
+    for(int32_t i = 0; i > k; i--) {
+        sum /= 2.0;
+    }
+    return sum;
+}
+
+constexpr auto ntc_resistance(const int32_t temp) -> double {
+    const double kelvin = temp + KELVIN;
+    return NTC_R25 * exponential(NTC_B * ((1.0 / kelvin) - (1.0 / NTC_T25)));
+}
+
+/// @brief Nearest wiper code to resistance, limited to what the potentiometer can reach.
+constexpr auto wiper_code(const double resistance) -> uint8_t {
+    const double code = (resistance - POT_WIPER_RESISTANCE) * POT_CODES / POT_RESISTANCE;
+    return static_cast<uint8_t>(std::clamp(code + 0.5, 0.0, POT_CODES - 1.0));
+}
+
+/// @brief The usable range runs from the coldest whole degree the potentiometer can reach without
+///        sitting at full scale, up to the hottest that's still a whole code below the degree
+///        before it. Past that, neighbouring degrees would share a code.
+constexpr int32_t SEARCH_MIN = -40;
+constexpr int32_t SEARCH_MAX = 125;
+
+constexpr int32_t TEMP_MIN = [] {
+    int32_t temp = SEARCH_MIN;
+    while(temp < SEARCH_MAX && wiper_code(ntc_resistance(temp)) == POT_CODES - 1) {
+        temp++;
+    }
+    return temp;
+}();
+
+constexpr int32_t TEMP_MAX = [] {
+    int32_t temp = TEMP_MIN;
+    while(temp < SEARCH_MAX
+          && wiper_code(ntc_resistance(temp + 1)) < wiper_code(ntc_resistance(temp))) {
+        temp++;
+    }
+    return temp;
+}();
+
+static_assert(TEMP_MIN <= 25 && 25 <= TEMP_MAX,
+              "The thermistor and potentiometer options can't reach 25C");
+
+/// @brief Wiper code for each whole degree from TEMP_MIN to TEMP_MAX, so setting a temperature is
+///        a single lookup with no floating point at run time.
+constexpr auto WIPER_CODES = [] {
+    std::array<uint8_t, TEMP_MAX - TEMP_MIN + 1> table{};
+    for(int32_t temp = TEMP_MIN; temp <= TEMP_MAX; temp++) {
+        table[static_cast<uint32_t>(temp - TEMP_MIN)] = wiper_code(ntc_resistance(temp));
+    }
+    return table;
+}();
+
+static_assert(std::ranges::adjacent_find(WIPER_CODES, std::ranges::less_equal{})
+                  == WIPER_CODES.end(),
+              "Wiper codes must strictly fall as the NTC warms");
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// private variables
 /*------------------------------------------------------------------------------------------------*/
 
 namespace {
@@ -34,8 +148,11 @@ auto thermistor::init() -> void {
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @brief Set the potentiometer to the NTC's resistance at temp degrees C. Clamped to the usable
+///        range.
 auto thermistor::set_temp(const int32_t temp) -> void {
-    uint8_t out = 127;
+    const auto index = static_cast<uint32_t>(std::clamp(temp, TEMP_MIN, TEMP_MAX) - TEMP_MIN);
+    uint8_t out = WIPER_CODES[index];
     XSpi_SetSlaveSelect(&spi, 1);
     XSpi_Transfer(&spi, &out, nullptr, 1);
 }
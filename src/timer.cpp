@@ -0,0 +1,58 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    timer.cpp
+/// @brief   Free running cycle counter used to timestamp events.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdint>
+
+#include "xil_io.h"
+#include "xparameters.h"
+
+#include "timer.hpp"
+
+/*------------------------------------------------------------------------------------------------*/
+
+#ifdef XPAR_TMRCTR_0_BASEADDR
+
+namespace {
+
+constexpr uint32_t BASE_ADDRESS = XPAR_TMRCTR_0_BASEADDR;
+
+// AXI Timer counter 0 registers. Accessed directly rather than through the tmrctr driver to keep
+// now() down to a single bus read.
+constexpr uint32_t TCSR0_OFFSET = 0x00;
+constexpr uint32_t TLR0_OFFSET = 0x04;
+constexpr uint32_t TCR0_OFFSET = 0x08;
+
+constexpr uint32_t TCSR_ARHT = 0x010;
+constexpr uint32_t TCSR_LOAD = 0x020;
+constexpr uint32_t TCSR_ENT = 0x080;
+
+}
+
+#endif
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto timer::init() -> void {
+#ifdef XPAR_TMRCTR_0_BASEADDR
+    // Count up from 0 and wrap.
+    Xil_Out32(BASE_ADDRESS + TLR0_OFFSET, 0);
+    Xil_Out32(BASE_ADDRESS + TCSR0_OFFSET, TCSR_LOAD);
+    Xil_Out32(BASE_ADDRESS + TCSR0_OFFSET, TCSR_ARHT | TCSR_ENT);
+#endif
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto timer::now() -> uint32_t {
+#ifdef XPAR_TMRCTR_0_BASEADDR
+    return Xil_In32(BASE_ADDRESS + TCR0_OFFSET);
+#else
+    return 0;
+#endif
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,38 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @author  Ryan Sullivan (ryansullivan@googlemail.com)
+///
+/// @file    timer.hpp
+/// @brief   Free running cycle counter used to timestamp events.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cstdint>
+
+#include "xparameters.h"
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace timer {
+
+/// Timestamps need an AXI Timer in the block design. Without one now() always returns 0.
+#ifdef XPAR_TMRCTR_0_BASEADDR
+constexpr bool AVAILABLE = true;
+#else
+constexpr bool AVAILABLE = false;
+#endif
+
+constexpr uint32_t FREQUENCY = XPAR_CPU_M_AXI_DP_FREQ_HZ;
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace timer {
+
+auto init() -> void;
+
+auto now() -> uint32_t;
+
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -5,12 +5,18 @@
 /// @brief   Module for handling reading and writing from/to the uart peripheral.
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+#include <algorithm>
 #include <cstdint>
+#include <iterator>
 
 #include "xparameters.h"
 #include "xuartlite.h"
+#include "xuartlite_l.h"
 
 #include "interrupt.hpp"
+#include "ring_buffer.hpp"
+#include "scheduler.hpp"
+#include "timer.hpp"
 #include "uart.hpp"
 
 /*------------------------------------------------------------------------------------------------*/
@@ -22,15 +28,45 @@ namespace {
 constexpr uint16_t DEVICE_ID = XPAR_UARTLITE_0_DEVICE_ID;
 XUartLite uart_instance;
 
-auto tx_buffer = std::array<volatile uint8_t, 1024>{};
-volatile uint32_t tx_buffer_in_ptr = 0;
-volatile uint32_t tx_buffer_out_ptr = 0;
-volatile uint32_t tx_buffer_count = 0;
-
-auto rx_buffer = std::array<volatile uint8_t, 1024>{};
-volatile uint32_t rx_buffer_in_ptr = 0;
-volatile uint32_t rx_buffer_out_ptr = 0;
-volatile uint32_t rx_buffer_count = 0;
+// Bulk data to send is either copied into tx_buffer or queued in place as a segment. Each segment
+// records how far through tx_buffer it was queued so the two are sent in the order written, and
+// whether it's the last of its write.
+struct Segment {
+    uint32_t position;
+    std::span<const uint8_t> data;
+    bool write_end;
+};
+
+enum class Sending {
+    Control,
+    Bytes,
+    Segment,
+};
+
+// Writers wait for room rather than lose part of a frame. The transmit ISR is always draining
+// tx_buffer while it holds anything so the wait is bounded.
+constinit RingBuffer<uint8_t, 1024, Overflow::Block> tx_buffer{};
+constinit RingBuffer<Segment, 16> tx_segments{};
+
+// Short control frames jump ahead of bulk data, but only once the bulk frame being sent has
+// finished so the two are never interleaved. Only whole writes are sent from either buffer, up to
+// where the last write ended.
+constinit RingBuffer<uint8_t, 256, Overflow::Block> tx_control{};
+constinit volatile uint32_t tx_control_ready{0};
+constinit volatile uint32_t tx_bulk_ready{0};
+constinit volatile bool tx_bulk_at_boundary{true};
+
+constinit volatile bool tx_active{false};
+constinit volatile Sending tx_sending{Sending::Bytes};
+constinit volatile bool tx_send_ends_write{false};
+
+// Writes refused by try_write() and try_write_priority() for want of room, counted as each
+// buffer's drops.
+constinit uint32_t tx_refused{0};
+constinit uint32_t tx_control_refused{0};
+
+constinit RingBuffer<uint8_t, 1024> rx_buffer{};
+constinit volatile uint32_t rx_time{0};
 
 }
 
@@ -43,7 +79,15 @@ namespace {
 auto receive_isr(XUartLite* instance, uint32_t bytes) -> void;
 auto transmit_isr(XUartLite* instance, uint32_t bytes) -> void;
 
-auto start_transmission() -> void;
+auto start_transmission() -> bool;
+auto send(std::span<const uint8_t> data) -> void;
+
+auto kick_transmission() -> void;
+
+template<uint32_t N>
+auto queue(RingBuffer<uint8_t, N, Overflow::Block>& buffer,
+           volatile uint32_t& ready,
+           std::span<const uint8_t> data) -> void;
 
 }
 
@@ -59,7 +103,7 @@ auto uart::init() -> std::optional<Error> {
     }
 
     interrupt::enable(interrupt::Interrupt::Uart,
-                      (XInterruptHandler)XUartLite_InterruptHandler,
+                      (interrupt::Handler)XUartLite_InterruptHandler,
                       &uart_instance);
 
     XUartLite_SetSendHandler(&uart_instance, (XUartLite_Handler)transmit_isr, &uart_instance);
@@ -67,72 +111,154 @@ auto uart::init() -> std::optional<Error> {
 
     XUartLite_EnableInterrupt(&uart_instance);
 
-    // Setup next RX request.
-    XUartLite_Recv(&uart_instance, (uint8_t*)&rx_buffer[rx_buffer_in_ptr], 1);
-
     return std::nullopt;
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
 auto uart::write(const uint8_t byte) -> void {
-    tx_buffer[tx_buffer_in_ptr] = byte;
-    tx_buffer_in_ptr = (tx_buffer_in_ptr + 1) % tx_buffer.size();
-    tx_buffer_count++;
-
-    if(XUartLite_IsSending(&uart_instance) == 0) {
-        start_transmission();
-    }
+    queue(tx_buffer, tx_bulk_ready, std::span(&byte, 1));
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
 auto uart::write(std::span<const uint8_t> data) -> void {
-    for(const auto byte : data) {
-        tx_buffer[tx_buffer_in_ptr] = byte;
-        tx_buffer_in_ptr = (tx_buffer_in_ptr + 1) % tx_buffer.size();
-        tx_buffer_count++;
+    queue(tx_buffer, tx_bulk_ready, data);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto uart::write(std::span<const char> data) -> void {
+    write(std::span(reinterpret_cast<const uint8_t*>(data.data()), data.size()));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Queue segments to be sent straight from the caller's memory without copying. The memory
+///        must stay valid until the returned ticket is sent.
+/// @return std::nullopt if there isn't room to queue every segment. Nothing is queued.
+auto uart::write(std::span<const std::span<const uint8_t>> segments) -> std::optional<Ticket> {
+    if(segments.size() > tx_segments.free()) {
+        return std::nullopt;
     }
 
-    if(XUartLite_IsSending(&uart_instance) == 0) {
-        start_transmission();
+    const auto last = std::find_if(segments.rbegin(), segments.rend(), [](const auto segment) {
+        return !segment.empty();
+    });
+
+    for(auto segment = segments.begin(); segment != segments.end(); segment++) {
+        if(!segment->empty()) {
+            tx_segments.push(Segment{.position = tx_buffer.pushed(),
+                                     .data = *segment,
+                                     .write_end = (segment == std::prev(last.base()))});
+        }
     }
+
+    kick_transmission();
+    return tx_segments.pushed();
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
-auto uart::write(std::span<const char> data) -> void {
-    for(const auto byte : data) {
-        tx_buffer[tx_buffer_in_ptr] = byte;
-        tx_buffer_in_ptr = (tx_buffer_in_ptr + 1) % tx_buffer.size();
-        tx_buffer_count++;
+/// @brief Queue a short control frame to be sent ahead of any bulk data not yet started.
+auto uart::write_priority(std::span<const uint8_t> data) -> void {
+    queue(tx_control, tx_control_ready, data);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto uart::write_priority(std::span<const char> data) -> void {
+    write_priority(std::span(reinterpret_cast<const uint8_t*>(data.data()), data.size()));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Queue data only if all of it fits now, for writers that mustn't wait for the link.
+/// @return false if it doesn't fit. Nothing is queued and the write is counted as dropped.
+auto uart::try_write(std::span<const uint8_t> data) -> bool {
+    if(data.size() > tx_buffer.free()) {
+        tx_refused++;
+        return false;
     }
 
-    if(XUartLite_IsSending(&uart_instance) == 0) {
-        start_transmission();
+    write(data);
+    return true;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief As try_write(), for a control frame.
+auto uart::try_write_priority(std::span<const uint8_t> data) -> bool {
+    if(data.size() > tx_control.free()) {
+        tx_control_refused++;
+        return false;
     }
+
+    write_priority(data);
+    return true;
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
-auto uart::read() -> uint8_t {
-    const auto byte = rx_buffer[rx_buffer_out_ptr];
-    rx_buffer_out_ptr = (rx_buffer_out_ptr + 1) % rx_buffer.size();
-    rx_buffer_count--;
+auto uart::ticket() -> Ticket {
+    return tx_segments.pushed();
+}
 
-    return byte;
+/*------------------------------------------------------------------------------------------------*/
+
+auto uart::sent(const Ticket ticket) -> bool {
+    return static_cast<int32_t>(tx_segments.popped() - ticket) >= 0;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Read as many received bytes as are available, up to the size of data.
+/// @return Number of bytes read.
+auto uart::read(std::span<uint8_t> data) -> uint32_t {
+    return rx_buffer.pop(data);
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
 auto uart::free() -> uint32_t {
-    return tx_buffer.size() - tx_buffer_count;
+    return tx_buffer.free();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto uart::free_priority() -> uint32_t {
+    return tx_control.free();
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
 auto uart::received() -> uint32_t {
-    return rx_buffer_count;
+    return rx_buffer.size();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Time of the last receive interrupt. Everything read so far had arrived by then.
+auto uart::receive_time() -> uint32_t {
+    return rx_time;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto uart::idle() -> bool {
+    return tx_buffer.empty() && tx_segments.empty() && tx_control.empty();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+auto uart::queue_stats() -> Queues {
+    auto queues = Queues{.tx_buffer = tx_buffer.stats(),
+                         .tx_segments = tx_segments.stats(),
+                         .rx_buffer = rx_buffer.stats(),
+                         .tx_control = tx_control.stats()};
+    queues.tx_buffer.dropped += tx_refused;
+    queues.tx_control.dropped += tx_control_refused;
+    return queues;
 }
 
 /*------------------------------------------------------------------------------------------------*/
@@ -153,54 +279,141 @@ auto uart::error_message(Error error) -> std::string_view {
 
 namespace {
 
+/// @brief Called by the driver whenever the receive FIFO holds data. No receive is ever requested
+///        from the driver so bytes is always 0. Instead the whole FIFO is emptied straight into
+///        rx_buffer from the registers. Bytes are dropped if it's full.
 auto receive_isr([[maybe_unused]] XUartLite* instance, [[maybe_unused]] uint32_t bytes) -> void {
     interrupt::acknowledge(interrupt::Interrupt::Uart);
+    rx_time = timer::now();
+
+    const UINTPTR base = uart_instance.RegBaseAddress;
+    auto space = rx_buffer.write_span();
+    uint32_t count = 0;
+
+    while(!XUartLite_IsReceiveEmpty(base)) {
+        const auto byte = static_cast<uint8_t>(XUartLite_ReadReg(base, XUL_RX_FIFO_OFFSET));
+
+        // Publish what's been written when the contiguous space runs out and carry on from the
+        // start of the ring.
+        if(count == space.size()) {
+            rx_buffer.commit(count);
+            space = rx_buffer.write_span();
+            count = 0;
+        }
+
+        if(space.empty()) {
+            rx_buffer.record_drop();
+        } else {
+            space[count++] = byte;
+        }
+    }
 
-    // const uint32_t bytes_until_overflow = rx_buffer.size() - rx_buffer_in_ptr;
-    // if(bytes > bytes_until_overflow) {
-    //     XUartLite_Recv(&uart_instance,
-    //                    (uint8_t*)&rx_buffer[rx_buffer_in_ptr],
-    //                    bytes_until_overflow);
+    rx_buffer.commit(count);
+    scheduler::signal(scheduler::Commands);
+}
 
-    //     rx_buffer_in_ptr = (rx_buffer_in_ptr + bytes_until_overflow) % rx_buffer.size();
-    //     rx_buffer_count += bytes_until_overflow;
-    //     bytes -= bytes_until_overflow;
-    // }
+/*------------------------------------------------------------------------------------------------*/
 
-    // XUartLite_Recv(&uart_instance, (uint8_t*)&rx_buffer[rx_buffer_in_ptr], bytes);
-    // rx_buffer_in_ptr = (rx_buffer_in_ptr + bytes) % rx_buffer.size();
-    // rx_buffer_count += bytes;
+auto transmit_isr([[maybe_unused]] XUartLite* instance, uint32_t bytes) -> void {
+    interrupt::acknowledge(interrupt::Interrupt::Uart);
 
-    rx_buffer_in_ptr = (rx_buffer_in_ptr + 1) % rx_buffer.size();
-    rx_buffer_count++;
+    switch(tx_sending) {
+        case Sending::Control: tx_control.consume(bytes); break;
+        case Sending::Bytes: tx_buffer.consume(bytes); break;
+        case Sending::Segment: tx_segments.consume(1); break;
+    }
+
+    if(tx_sending != Sending::Control) {
+        tx_bulk_at_boundary = tx_send_ends_write;
+    }
 
-    // Setup next RX request.
-    XUartLite_Recv(&uart_instance, (uint8_t*)&rx_buffer[rx_buffer_in_ptr], 1);
+    tx_active = start_transmission();
+
+    // Space, line slots or an idle link may be what streaming was waiting for.
+    scheduler::signal(scheduler::Stream);
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
-auto transmit_isr([[maybe_unused]] XUartLite* instance, uint32_t bytes) -> void {
-    interrupt::acknowledge(interrupt::Interrupt::Uart);
+/// @brief Start sending control frames if bulk data is between writes, otherwise the next segment
+///        if it's due, otherwise the copied bytes ahead of it.
+/// @return false if there was nothing to send.
+auto start_transmission() -> bool {
+    if(tx_bulk_at_boundary) {
+        const uint32_t ready = tx_control_ready - tx_control.popped();
+        const auto control = tx_control.read_span();
+        const auto data = control.first(std::min<size_t>(control.size(), ready));
+
+        if(!data.empty()) {
+            tx_sending = Sending::Control;
+            send(data);
+            return true;
+        }
+    }
+
+    const auto segments = tx_segments.read_span();
+    uint32_t ready = tx_bulk_ready - tx_buffer.popped();
 
-    tx_buffer_out_ptr = (tx_buffer_out_ptr + bytes) % tx_buffer.size();
-    tx_buffer_count -= bytes;
+    if(!segments.empty()) {
+        const uint32_t ahead = segments.front().position - tx_buffer.popped();
+        if(ahead == 0) {
+            const auto& segment = segments.front();
 
-    if(tx_buffer_count != 0) {
-        start_transmission();
+            tx_sending = Sending::Segment;
+            tx_send_ends_write = segment.write_end;
+            send(segment.data);
+            return true;
+        }
+
+        ready = std::min(ready, ahead);
     }
+
+    const auto pending = tx_buffer.read_span();
+    const auto data = pending.first(std::min<size_t>(pending.size(), ready));
+    if(data.empty()) {
+        return false;
+    }
+
+    // A send cut short where the buffer wraps may stop part way through a write.
+    tx_sending = Sending::Bytes;
+    tx_send_ends_write = (data.size() == ready);
+    send(data);
+    return true;
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
-auto start_transmission() -> void {
-    auto bytes = tx_buffer_count;
+auto send(std::span<const uint8_t> data) -> void {
+    XUartLite_Send(&uart_instance,
+                   const_cast<uint8_t*>(data.data()),
+                   static_cast<uint32_t>(data.size()));
+}
+
+/*------------------------------------------------------------------------------------------------*/
 
-    if(bytes > (tx_buffer.size() - tx_buffer_out_ptr)) {
-        bytes = (tx_buffer.size() - tx_buffer_out_ptr);
+auto kick_transmission() -> void {
+    // Once active the transmit ISR keeps going until everything queued has been sent.
+    if(!tx_active) {
+        tx_active = start_transmission();
     }
+}
+
+/*------------------------------------------------------------------------------------------------*/
 
-    XUartLite_Send(&uart_instance, (uint8_t*)&tx_buffer[tx_buffer_out_ptr], bytes);
+/// @brief Copy data into a transmit buffer and mark it ready to send. Queued at most a buffer's
+///        worth at a time, so transmission is already running whenever the push has to wait for
+///        space.
+template<uint32_t N>
+auto queue(RingBuffer<uint8_t, N, Overflow::Block>& buffer,
+           volatile uint32_t& ready,
+           std::span<const uint8_t> data) -> void {
+    while(!data.empty()) {
+        const auto chunk = data.first(std::min<size_t>(data.size(), buffer.capacity()));
+        buffer.push(chunk);
+        ready = buffer.pushed();
+        kick_transmission();
+        data = data.subspan(chunk.size());
+    }
 }
 
 }
@@ -6,12 +6,15 @@
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma once
 
+#include <array>
 #include <cstddef>
 #include <cstdint>
 #include <optional>
 #include <span>
 #include <string_view>
 
+#include "ring_buffer.hpp"
+
 /*------------------------------------------------------------------------------------------------*/
 // Error handling.
 /*------------------------------------------------------------------------------------------------*/
@@ -26,6 +29,26 @@ enum class Error : uint32_t {
 
 }
 
+/*------------------------------------------------------------------------------------------------*/
+// public types
+/*------------------------------------------------------------------------------------------------*/
+
+namespace uart {
+
+/// @brief Identifies queued segments. Once a ticket is sent every segment queued before it has
+///        been transmitted and its memory can be reused.
+using Ticket = uint32_t;
+
+/// @brief Usage of each of the module's queues.
+struct Queues {
+    QueueStats tx_buffer;
+    QueueStats tx_segments;
+    QueueStats rx_buffer;
+    QueueStats tx_control;
+};
+
+}
+
 /*------------------------------------------------------------------------------------------------*/
 // public functions
 /*------------------------------------------------------------------------------------------------*/
@@ -37,11 +60,26 @@ auto init() -> std::optional<Error>;
 auto write(uint8_t byte) -> void;
 auto write(std::span<const uint8_t> data) -> void;
 auto write(std::span<const char> data) -> void;
+auto write(std::span<const std::span<const uint8_t>> segments) -> std::optional<Ticket>;
+
+auto write_priority(std::span<const uint8_t> data) -> void;
+auto write_priority(std::span<const char> data) -> void;
 
-auto read() -> uint8_t;
+auto try_write(std::span<const uint8_t> data) -> bool;
+auto try_write_priority(std::span<const uint8_t> data) -> bool;
+
+auto ticket() -> Ticket;
+auto sent(Ticket ticket) -> bool;
+
+auto read(std::span<uint8_t> data) -> uint32_t;
 
 auto free() -> uint32_t;
+auto free_priority() -> uint32_t;
 auto received() -> uint32_t;
+auto receive_time() -> uint32_t;
+auto idle() -> bool;
+
+auto queue_stats() -> Queues;
 
 auto error_message(Error error) -> std::string_view;
 
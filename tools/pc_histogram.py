@@ -0,0 +1,176 @@
+#!/usr/bin/env python3
+"""Fetch the PC sample histogram from the analyser and attribute it to functions in the ELF.
+
+Needs firmware built with -Dpc_sampling=true. Each 'H' dump covers the time since the previous
+one, so run it once to reset, start the print, then run it again. Pass --cobs if the link has
+been switched to COBS framing with 'O'.
+"""
+
+import argparse
+import bisect
+import struct
+import subprocess
+
+import serial
+
+STX = 0x02
+ETX = 0x03
+ESC = 0x1B
+COBS_DELIMITER = 0x00
+
+
+def read_escaped_frames(port):
+    """Yield (opcode, payload) for each escaped frame received."""
+    frame = None
+    escaped = False
+    while True:
+        data = port.read(1)
+        if not data:
+            raise TimeoutError("no response from the analyser")
+
+        byte = data[0]
+        if escaped:
+            if frame is not None:
+                frame.append(byte)
+            escaped = False
+        elif byte == ESC:
+            escaped = True
+        elif byte == STX:
+            frame = bytearray()
+        elif byte == ETX and frame:
+            yield frame[0], bytes(frame[1:])
+            frame = None
+        elif frame is not None:
+            frame.append(byte)
+
+
+def cobs_encode(data):
+    """Stuff data so it holds no zeros, as the analyser's cobs_encode() does."""
+    output = bytearray([0])
+    code_index = 0
+    code = 1
+    for byte in data:
+        if byte != 0:
+            output.append(byte)
+            code += 1
+        if byte == 0 or code == 0xFF:
+            output[code_index] = code
+            code_index = len(output)
+            output.append(0)
+            code = 1
+    output[code_index] = code
+    return bytes(output)
+
+
+def cobs_decode(data):
+    """Undo cobs_encode(), returning None if the block is malformed."""
+    output = bytearray()
+    index = 0
+    while index < len(data):
+        code = data[index]
+        index += 1
+        if code == 0 or index + code - 1 > len(data):
+            return None
+        output += data[index : index + code - 1]
+        index += code - 1
+        if code != 0xFF and index != len(data):
+            output.append(0)
+    return bytes(output)
+
+
+def read_cobs_frames(port):
+    """Yield (opcode, payload) for each COBS frame received."""
+    block = bytearray()
+    while True:
+        data = port.read(1)
+        if not data:
+            raise TimeoutError("no response from the analyser")
+
+        if data[0] != COBS_DELIMITER:
+            block.append(data[0])
+            continue
+
+        frame = cobs_decode(bytes(block)) if block else None
+        block = bytearray()
+        if frame:
+            yield frame[0], frame[1:]
+
+
+def fetch_histogram(port, cobs):
+    """Request a dump and return (low_pc, bucket_size, counts)."""
+    if cobs:
+        port.write(bytes([COBS_DELIMITER]) + cobs_encode(b"H") + bytes([COBS_DELIMITER]))
+        frames = read_cobs_frames(port)
+    else:
+        port.write(bytes([STX, ord("H"), ETX]))
+        frames = read_escaped_frames(port)
+
+    counts = None
+    received = 0
+    for opcode, payload in frames:
+        if opcode != ord("H"):
+            continue
+
+        low_pc, bucket_size, total, first = struct.unpack_from("<IIHH", payload)
+        frame_counts = struct.unpack_from(f"<{(len(payload) - 12) // 2}H", payload, 12)
+
+        if counts is None:
+            counts = [0] * total
+        counts[first : first + len(frame_counts)] = frame_counts
+        received += len(frame_counts)
+        if received >= total:
+            return low_pc, bucket_size, counts
+
+
+def load_symbols(nm, elf):
+    """Return function start addresses and names sorted by address."""
+    output = subprocess.run(
+        [nm, "-n", "-C", "--defined-only", elf], check=True, capture_output=True, text=True
+    ).stdout
+
+    addresses = []
+    names = []
+    for line in output.splitlines():
+        parts = line.split(maxsplit=2)
+        if len(parts) == 3 and parts[1] in "tTwW":
+            addresses.append(int(parts[0], 16))
+            names.append(parts[2])
+    return addresses, names
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("port", help="serial port of the analyser")
+    parser.add_argument("elf", help="firmware ELF the analyser is running")
+    parser.add_argument("--baud", type=int, default=230400)
+    parser.add_argument("--cobs", action="store_true", help="the link is using COBS framing")
+    parser.add_argument("--nm", default="microblaze-xilinx-elf-nm")
+    parser.add_argument("--top", type=int, default=20, help="number of functions to list")
+    args = parser.parse_args()
+
+    with serial.Serial(args.port, args.baud, timeout=2) as port:
+        low_pc, bucket_size, counts = fetch_histogram(port, args.cobs)
+
+    addresses, names = load_symbols(args.nm, args.elf)
+
+    # Buckets can straddle functions. Attribute each to the function its first address is in.
+    samples = {}
+    for index, count in enumerate(counts):
+        if count == 0:
+            continue
+        symbol = bisect.bisect_right(addresses, low_pc + index * bucket_size) - 1
+        name = names[symbol] if symbol >= 0 else "?"
+        samples[name] = samples.get(name, 0) + count
+
+    total = sum(samples.values())
+    if total == 0:
+        print("no samples")
+        return
+
+    print(f"{total} samples, {bucket_size} bytes per bucket")
+    for name, count in sorted(samples.items(), key=lambda item: item[1], reverse=True)[: args.top]:
+        print(f"{100 * count / total:6.2f}% {count:8} {name}")
+
+
+if __name__ == "__main__":
+    main()